@@ -0,0 +1,329 @@
+#ifndef __TBandMatrix_H__
+#define __TBandMatrix_H__
+
+#include <cmath>
+#include <limits>
+#include "tmatrix.h"
+
+// A size x size matrix whose nonzero elements lie on the diagonals -lower..upper,
+// as produced by finite-difference stencils. Storage is diagonal-major: diagonal d
+// is one contiguous array indexed by row, holding (i, i + d) at position i, so that
+// storage and the matrix-vector product are O(size * bandwidth). Positions of a
+// diagonal that fall outside the matrix are kept zero.
+//
+// It is also a matrix expression, so it can be assigned to or combined with dense
+// matrices.
+template<typename T>
+class TBandMatrix : public TMatrixExpr<TBandMatrix<T>>
+{
+protected:
+    size_t size;
+    size_t lower;
+    size_t upper;
+    T* pData;
+    std::pmr::memory_resource* pRes;
+
+    static void check_size(size_t s, size_t kl, size_t ku)
+    {
+        if (s == 0)
+            throw out_of_range("Matrix size must be greater than 0");
+        if (s > MAX_VECTOR_LEN)
+            throw out_of_range("Matrix size exceeds maximum limit");
+        if (kl >= s || ku >= s)
+            throw out_of_range("Bandwidth must be less than matrix size");
+    }
+
+    size_t stored_length() const
+    {
+        return tmemory::checked_mul(size, lower + upper + 1);
+    }
+
+    bool in_band(size_t i, size_t j) const noexcept
+    {
+        return j + lower >= i && j <= i + upper;
+    }
+
+public:
+    typedef T value_type;
+
+    TBandMatrix(size_t s = 1, size_t kl = 0, size_t ku = 0,
+                std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(s), lower(kl), upper(ku), pRes(res)
+    {
+        check_size(s, kl, ku);
+        pData = tmemory::create<T>(pRes, stored_length());
+    }
+
+    // Takes the band -kl..ku of a square matrix; the rest is ignored.
+    TBandMatrix(const TDynamicMatrix<T>& m, size_t kl, size_t ku,
+                std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TBandMatrix(m.rows(), kl, ku, res)
+    {
+        if (!m.is_square()) throw length_error("Band matrix must be square");
+        for (size_t i = 0; i < size; ++i)
+            for (size_t j = i > lower ? i - lower : 0; j <= std::min(size - 1, i + upper); ++j)
+                (*this)(i, j) = m(i, j);
+    }
+
+    TBandMatrix(const TBandMatrix& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(m.size), lower(m.lower), upper(m.upper), pRes(res)
+    {
+        pData = tmemory::create_copy(pRes, m.pData, stored_length());
+    }
+
+    TBandMatrix(TBandMatrix&& m) noexcept : size(0), lower(0), upper(0), pData(nullptr), pRes(m.pRes)
+    {
+        swap(*this, m);
+    }
+
+    ~TBandMatrix()
+    {
+        tmemory::destroy(pRes, pData, stored_length());
+        pData = nullptr;
+    }
+
+    TBandMatrix& operator=(const TBandMatrix& m)
+    {
+        if (this == &m) return *this;
+
+        if (stored_length() != m.stored_length())
+        {
+            T* newData = tmemory::create_copy(pRes, m.pData, m.stored_length());
+            tmemory::destroy(pRes, pData, stored_length());
+            pData = newData;
+        }
+        else
+            std::copy(m.pData, m.pData + m.stored_length(), pData);
+        size = m.size;
+        lower = m.lower;
+        upper = m.upper;
+
+        return *this;
+    }
+
+    TBandMatrix& operator=(TBandMatrix&& m)
+    {
+        if (this == &m) return *this;
+        if (pRes != m.pRes && !(*pRes == *m.pRes)) return *this = m;
+
+        tmemory::destroy(pRes, pData, stored_length());
+        pData = nullptr;
+        size = lower = upper = 0;
+        swap(*this, m);
+
+        return *this;
+    }
+
+    TBandMatrix& operator+=(const TBandMatrix& m)
+    {
+        if (m.size != size || m.lower != lower || m.upper != upper)
+            throw length_error("Matrix dimensions mismatch");
+        tsimd::add(stored_length(), pData, m.pData, pData);
+        return *this;
+    }
+
+    TBandMatrix& operator-=(const TBandMatrix& m)
+    {
+        if (m.size != size || m.lower != lower || m.upper != upper)
+            throw length_error("Matrix dimensions mismatch");
+        tsimd::sub(stored_length(), pData, m.pData, pData);
+        return *this;
+    }
+
+    TBandMatrix& operator*=(const T& val)
+    {
+        tsimd::scale(stored_length(), pData, val, pData);
+        return *this;
+    }
+
+    size_t rows() const noexcept { return size; }
+
+    size_t cols() const noexcept { return size; }
+
+    size_t get_size() const noexcept { return size; }
+
+    size_t lower_bandwidth() const noexcept { return lower; }
+
+    size_t upper_bandwidth() const noexcept { return upper; }
+
+    std::pmr::memory_resource* get_resource() const noexcept { return pRes; }
+
+    // Diagonal d, -lower <= d <= upper, as an array indexed by row.
+    T* diagonal(ptrdiff_t d) noexcept
+    {
+        assert(d >= -ptrdiff_t(lower) && d <= ptrdiff_t(upper) && "Diagonal outside the band");
+        return pData + (d + ptrdiff_t(lower)) * size;
+    }
+
+    const T* diagonal(ptrdiff_t d) const noexcept
+    {
+        assert(d >= -ptrdiff_t(lower) && d <= ptrdiff_t(upper) && "Diagonal outside the band");
+        return pData + (d + ptrdiff_t(lower)) * size;
+    }
+
+    // Element access inside the band.
+    T& operator()(size_t i, size_t j) noexcept
+    {
+        assert(in_band(i, j) && "Element outside the band is not stored");
+        return pData[(j + lower - i) * size + i];
+    }
+
+    T operator()(size_t i, size_t j) const noexcept
+    {
+        return in_band(i, j) ? pData[(j + lower - i) * size + i] : T();
+    }
+
+    T& at(size_t i, size_t j)
+    {
+        if (i >= size || j >= size) throw out_of_range("Matrix index out of range");
+        if (!in_band(i, j)) throw out_of_range("Element outside the band is not stored");
+        return (*this)(i, j);
+    }
+
+    void eval_row(size_t i, T* dst) const
+    {
+        std::fill(dst, dst + size, T());
+        for (size_t j = i > lower ? i - lower : 0; j <= std::min(size - 1, i + upper); ++j)
+            dst[j] = pData[(j + lower - i) * size + i];
+    }
+
+    TDynamicMatrix<T> to_dense() const
+    {
+        return TDynamicMatrix<T>(*this);
+    }
+
+    bool operator==(const TBandMatrix& m) const noexcept
+    {
+        return size == m.size && lower == m.lower && upper == m.upper &&
+               std::equal(pData, pData + size * (lower + upper + 1), m.pData);
+    }
+
+    bool operator!=(const TBandMatrix& m) const noexcept
+    {
+        return !(*this == m);
+    }
+
+    // y = A * x one diagonal at a time: diagonal d adds diagonal(d)[i] * x[i + d]
+    // to y[i], a contiguous multiply-add over the rows where column i + d exists.
+    // Large products split the rows across matrix_executor().
+    TDynamicVector<T> multiply(const TDynamicVector<T>& x) const
+    {
+        TDynamicVector<T> res(size, uninitialized);
+        multiply(x, res);
+        return res;
+    }
+
+    // res = A * x into a vector of size elements, without allocating.
+    void multiply(const TDynamicVector<T>& x, TDynamicVector<T>& res) const
+    {
+        if (x.length() != size || res.length() != size)
+            throw length_error("Vector and Matrix dimensions incompatible");
+
+        const size_t grain = std::max<size_t>(1, PARALLEL_GRAIN / (lower + upper + 1));
+        run_ranges(size, grain, [&](size_t begin, size_t end)
+        {
+            std::fill(res.data() + begin, res.data() + end, T());
+            for (ptrdiff_t d = -ptrdiff_t(lower); d <= ptrdiff_t(upper); ++d)
+            {
+                const size_t first = std::max(begin, d < 0 ? size_t(-d) : size_t(0));
+                const size_t last = std::min(end, d > 0 ? size - size_t(d) : size);
+                if (first < last)
+                    tsimd::mul_add(last - first, diagonal(d) + first, x.data() + first + d,
+                                   res.data() + first);
+            }
+        });
+    }
+
+    // Solves A * x = rhs for a tridiagonal A by the Thomas algorithm in O(size).
+    // There is no pivoting, so A should be diagonally dominant or otherwise safe
+    // for elimination in order. As in TLUDecomposition, a pivot no larger than
+    // size * eps * max|a_ij| counts as zero and throws.
+    TDynamicVector<T> solve_tridiagonal(const TDynamicVector<T>& rhs) const
+    {
+        if (lower > 1 || upper > 1) throw length_error("Matrix is not tridiagonal");
+        if (rhs.length() != size) throw length_error("Vector and Matrix dimensions incompatible");
+
+        const T* a = lower ? diagonal(-1) : nullptr;
+        const T* b = diagonal(0);
+        const T* c = upper ? diagonal(1) : nullptr;
+
+        T amax = T();
+        for (size_t k = 0; k < stored_length(); ++k) amax = std::max<T>(amax, std::abs(pData[k]));
+        const T tolerance = T(size) * std::numeric_limits<T>::epsilon() * amax;
+
+        TDynamicVector<T> cp(size, uninitialized), x(size, uninitialized);
+        T pivot = b[0];
+        if (std::abs(pivot) <= tolerance) throw runtime_error("Zero pivot in tridiagonal solve");
+        cp[0] = c ? c[0] / pivot : T();
+        x[0] = rhs[0] / pivot;
+        for (size_t i = 1; i < size; ++i)
+        {
+            const T ai = a ? a[i] : T();
+            pivot = b[i] - ai * cp[i - 1];
+            if (std::abs(pivot) <= tolerance) throw runtime_error("Zero pivot in tridiagonal solve");
+            cp[i] = c ? c[i] / pivot : T();
+            x[i] = (rhs[i] - ai * x[i - 1]) / pivot;
+        }
+        for (size_t i = size - 1; i-- > 0;)
+            x[i] -= cp[i] * x[i + 1];
+        return x;
+    }
+
+    friend TBandMatrix operator+(const TBandMatrix& l, const TBandMatrix& r)
+    {
+        TBandMatrix res(l);
+        res += r;
+        return res;
+    }
+
+    friend TBandMatrix operator-(const TBandMatrix& l, const TBandMatrix& r)
+    {
+        TBandMatrix res(l);
+        res -= r;
+        return res;
+    }
+
+    friend TBandMatrix operator*(const TBandMatrix& m, const T& val)
+    {
+        TBandMatrix res(m);
+        res *= val;
+        return res;
+    }
+
+    friend TBandMatrix operator*(const T& val, const TBandMatrix& m)
+    {
+        return m * val;
+    }
+
+    friend TDynamicVector<T> operator*(const TBandMatrix& m, const TDynamicVector<T>& x)
+    {
+        return m.multiply(x);
+    }
+
+    friend void swap(TBandMatrix& lhs, TBandMatrix& rhs) noexcept
+    {
+        std::swap(lhs.size, rhs.size);
+        std::swap(lhs.lower, rhs.lower);
+        std::swap(lhs.upper, rhs.upper);
+        std::swap(lhs.pData, rhs.pData);
+        std::swap(lhs.pRes, rhs.pRes);
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TBandMatrix& m)
+    {
+        for (size_t i = 0; i < m.size; ++i)
+        {
+            for (size_t j = 0; j < m.size; ++j) ostr << m(i, j) << ' ';
+            ostr << endl;
+        }
+        return ostr;
+    }
+};
+
+template<typename T>
+struct TExprOperand<TBandMatrix<T>>
+{
+    typedef const TBandMatrix<T>& type;
+};
+
+#endif
@@ -0,0 +1,386 @@
+#ifndef __TExpr_H__
+#define __TExpr_H__
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "tsimd.h"
+
+// Lazy vector and matrix expressions. The arithmetic operators only build a tree of
+// nodes; the tree is evaluated in one fused loop when it is assigned to a vector or
+// a matrix, so no temporaries are allocated for intermediate results.
+//
+// A vector expression E provides value_type, length(), operator[](i) and
+// eval_to(dst, begin, end), which writes elements [begin, end) to dst.
+// A matrix expression provides value_type, rows(), cols(), operator()(i, j) and
+// eval_row(i, dst), which writes row i to dst.
+
+template<typename E>
+class TVectorExpr
+{
+public:
+    const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+template<typename E>
+class TMatrixExpr
+{
+public:
+    const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+// How a node keeps its operand: nodes and views are cheap and stored by value,
+// containers specialize this to be stored by reference.
+template<typename E>
+struct TExprOperand
+{
+    typedef const E type;
+};
+
+// Set for vectors whose elements are contiguous at data().
+template<typename E>
+struct TIsDenseVector : std::false_type {};
+
+// Set for matrices whose row i is contiguous at row_data(i).
+template<typename E>
+struct TIsDenseMatrix : std::false_type {};
+
+struct TAddOp
+{
+    template<typename T>
+    static T apply(const T& a, const T& b) { return a + b; }
+
+    template<typename T>
+    static void kernel(size_t n, const T* a, const T* b, T* r) { tsimd::add(n, a, b, r); }
+
+    template<typename T>
+    static void scalar_kernel(size_t n, const T* a, const T& s, T* r)
+    {
+        for (size_t i = 0; i < n; ++i) r[i] = a[i] + s;
+    }
+};
+
+struct TSubOp
+{
+    template<typename T>
+    static T apply(const T& a, const T& b) { return a - b; }
+
+    template<typename T>
+    static void kernel(size_t n, const T* a, const T* b, T* r) { tsimd::sub(n, a, b, r); }
+
+    template<typename T>
+    static void scalar_kernel(size_t n, const T* a, const T& s, T* r)
+    {
+        for (size_t i = 0; i < n; ++i) r[i] = a[i] - s;
+    }
+};
+
+struct TMulOp
+{
+    template<typename T>
+    static T apply(const T& a, const T& b) { return a * b; }
+
+    template<typename T>
+    static void scalar_kernel(size_t n, const T* a, const T& s, T* r) { tsimd::scale(n, a, s, r); }
+};
+
+template<typename L, typename R, typename Op>
+class TVectorBinary : public TVectorExpr<TVectorBinary<L, R, Op>>
+{
+public:
+    typedef typename L::value_type value_type;
+
+private:
+    static_assert(std::is_same<value_type, typename R::value_type>::value,
+                  "Operands must have the same element type");
+
+    typename TExprOperand<L>::type l;
+    typename TExprOperand<R>::type r;
+
+    void eval(value_type* dst, size_t begin, size_t end, std::true_type) const
+    {
+        Op::kernel(end - begin, l.data() + begin, r.data() + begin, dst + begin);
+    }
+
+    void eval(value_type* dst, size_t begin, size_t end, std::false_type) const
+    {
+        for (size_t i = begin; i < end; ++i) dst[i] = Op::apply(l[i], r[i]);
+    }
+
+public:
+    TVectorBinary(const L& _l, const R& _r) : l(_l), r(_r)
+    {
+        if (l.length() != r.length()) throw std::length_error("Vector lengths mismatch");
+    }
+
+    size_t length() const noexcept { return l.length(); }
+
+    value_type operator[](size_t i) const { return Op::apply(l[i], r[i]); }
+
+    void eval_to(value_type* dst, size_t begin, size_t end) const
+    {
+        eval(dst, begin, end, std::integral_constant<bool,
+             TIsDenseVector<L>::value && TIsDenseVector<R>::value>());
+    }
+};
+
+template<typename E, typename Op>
+class TVectorScalar : public TVectorExpr<TVectorScalar<E, Op>>
+{
+public:
+    typedef typename E::value_type value_type;
+
+private:
+    typename TExprOperand<E>::type e;
+    value_type s;
+
+    void eval(value_type* dst, size_t begin, size_t end, std::true_type) const
+    {
+        Op::scalar_kernel(end - begin, e.data() + begin, s, dst + begin);
+    }
+
+    void eval(value_type* dst, size_t begin, size_t end, std::false_type) const
+    {
+        for (size_t i = begin; i < end; ++i) dst[i] = Op::apply(e[i], s);
+    }
+
+public:
+    TVectorScalar(const E& _e, const value_type& _s) : e(_e), s(_s) {}
+
+    size_t length() const noexcept { return e.length(); }
+
+    value_type operator[](size_t i) const { return Op::apply(e[i], s); }
+
+    void eval_to(value_type* dst, size_t begin, size_t end) const
+    {
+        eval(dst, begin, end, TIsDenseVector<E>());
+    }
+};
+
+template<typename L, typename R, typename Op>
+class TMatrixBinary : public TMatrixExpr<TMatrixBinary<L, R, Op>>
+{
+public:
+    typedef typename L::value_type value_type;
+
+private:
+    static_assert(std::is_same<value_type, typename R::value_type>::value,
+                  "Operands must have the same element type");
+
+    typename TExprOperand<L>::type l;
+    typename TExprOperand<R>::type r;
+
+    void eval(size_t i, value_type* dst, std::true_type) const
+    {
+        Op::kernel(cols(), l.row_data(i), r.row_data(i), dst);
+    }
+
+    void eval(size_t i, value_type* dst, std::false_type) const
+    {
+        for (size_t j = 0; j < cols(); ++j) dst[j] = Op::apply(l(i, j), r(i, j));
+    }
+
+public:
+    TMatrixBinary(const L& _l, const R& _r) : l(_l), r(_r)
+    {
+        if (l.rows() != r.rows() || l.cols() != r.cols())
+            throw std::length_error("Matrix dimensions mismatch");
+    }
+
+    const L& left() const noexcept { return l; }
+
+    const R& right() const noexcept { return r; }
+
+    size_t rows() const noexcept { return l.rows(); }
+
+    size_t cols() const noexcept { return l.cols(); }
+
+    value_type operator()(size_t i, size_t j) const { return Op::apply(l(i, j), r(i, j)); }
+
+    void eval_row(size_t i, value_type* dst) const
+    {
+        eval(i, dst, std::integral_constant<bool,
+             TIsDenseMatrix<L>::value && TIsDenseMatrix<R>::value>());
+    }
+};
+
+template<typename E, typename Op>
+class TMatrixScalar : public TMatrixExpr<TMatrixScalar<E, Op>>
+{
+public:
+    typedef typename E::value_type value_type;
+
+private:
+    typename TExprOperand<E>::type e;
+    value_type s;
+
+    void eval(size_t i, value_type* dst, std::true_type) const
+    {
+        Op::scalar_kernel(cols(), e.row_data(i), s, dst);
+    }
+
+    void eval(size_t i, value_type* dst, std::false_type) const
+    {
+        for (size_t j = 0; j < cols(); ++j) dst[j] = Op::apply(e(i, j), s);
+    }
+
+public:
+    TMatrixScalar(const E& _e, const value_type& _s) : e(_e), s(_s) {}
+
+    const E& operand() const noexcept { return e; }
+
+    size_t rows() const noexcept { return e.rows(); }
+
+    size_t cols() const noexcept { return e.cols(); }
+
+    value_type operator()(size_t i, size_t j) const { return Op::apply(e(i, j), s); }
+
+    void eval_row(size_t i, value_type* dst) const
+    {
+        eval(i, dst, TIsDenseMatrix<E>());
+    }
+};
+
+// Whether evaluating e row by row into the rows x stride buffer at data could read
+// an element after it has been overwritten, i.e. whether some leaf reads a row of
+// that buffer other than the one being written. Leaves that read row i for row i,
+// or do not touch the buffer, need no overload; views that can alias add one.
+template<typename E, typename T>
+bool expr_reads_across_rows(const E&, const T*, size_t, size_t) noexcept
+{
+    return false;
+}
+
+template<typename L, typename R, typename Op, typename T>
+bool expr_reads_across_rows(const TMatrixBinary<L, R, Op>& e, const T* data, size_t rows, size_t stride) noexcept
+{
+    return expr_reads_across_rows(e.left(), data, rows, stride) ||
+           expr_reads_across_rows(e.right(), data, rows, stride);
+}
+
+template<typename E, typename Op, typename T>
+bool expr_reads_across_rows(const TMatrixScalar<E, Op>& e, const T* data, size_t rows, size_t stride) noexcept
+{
+    return expr_reads_across_rows(e.operand(), data, rows, stride);
+}
+
+// In-place updates dst[i] = Op(dst[i], e[i]) behind the compound assignment operators.
+template<typename Op, typename E>
+void expr_update(typename E::value_type* dst, const E& e, size_t begin, size_t end, std::true_type)
+{
+    Op::kernel(end - begin, dst + begin, e.data() + begin, dst + begin);
+}
+
+template<typename Op, typename E>
+void expr_update(typename E::value_type* dst, const E& e, size_t begin, size_t end, std::false_type)
+{
+    for (size_t i = begin; i < end; ++i) dst[i] = Op::apply(dst[i], e[i]);
+}
+
+template<typename Op, typename E>
+void expr_update(typename E::value_type* dst, const E& e, size_t begin, size_t end)
+{
+    expr_update<Op>(dst, e, begin, end, TIsDenseVector<E>());
+}
+
+template<typename Op, typename E>
+void expr_update_row(typename E::value_type* dst, const E& e, size_t i, std::true_type)
+{
+    Op::kernel(e.cols(), dst, e.row_data(i), dst);
+}
+
+template<typename Op, typename E>
+void expr_update_row(typename E::value_type* dst, const E& e, size_t i, std::false_type)
+{
+    for (size_t j = 0; j < e.cols(); ++j) dst[j] = Op::apply(dst[j], e(i, j));
+}
+
+template<typename Op, typename E>
+void expr_update_row(typename E::value_type* dst, const E& e, size_t i)
+{
+    expr_update_row<Op>(dst, e, i, TIsDenseMatrix<E>());
+}
+
+template<typename L, typename R>
+TVectorBinary<L, R, TAddOp> operator+(const TVectorExpr<L>& l, const TVectorExpr<R>& r)
+{
+    return TVectorBinary<L, R, TAddOp>(l.self(), r.self());
+}
+
+template<typename L, typename R>
+TVectorBinary<L, R, TSubOp> operator-(const TVectorExpr<L>& l, const TVectorExpr<R>& r)
+{
+    return TVectorBinary<L, R, TSubOp>(l.self(), r.self());
+}
+
+template<typename E>
+TVectorScalar<E, TAddOp> operator+(const TVectorExpr<E>& e, const typename E::value_type& val)
+{
+    return TVectorScalar<E, TAddOp>(e.self(), val);
+}
+
+template<typename E>
+TVectorScalar<E, TSubOp> operator-(const TVectorExpr<E>& e, const typename E::value_type& val)
+{
+    return TVectorScalar<E, TSubOp>(e.self(), val);
+}
+
+template<typename E>
+TVectorScalar<E, TMulOp> operator*(const TVectorExpr<E>& e, const typename E::value_type& val)
+{
+    return TVectorScalar<E, TMulOp>(e.self(), val);
+}
+
+template<typename E>
+TVectorScalar<E, TMulOp> operator*(const typename E::value_type& val, const TVectorExpr<E>& e)
+{
+    return TVectorScalar<E, TMulOp>(e.self(), val);
+}
+
+template<typename L, typename R>
+typename L::value_type expr_dot(const L& l, const R& r, std::true_type)
+{
+    return tsimd::dot(l.length(), l.data(), r.data());
+}
+
+template<typename L, typename R>
+typename L::value_type expr_dot(const L& l, const R& r, std::false_type)
+{
+    typename L::value_type sum = typename L::value_type();
+    for (size_t i = 0; i < l.length(); ++i) sum += l[i] * r[i];
+    return sum;
+}
+
+template<typename L, typename R>
+typename L::value_type operator*(const TVectorExpr<L>& l, const TVectorExpr<R>& r)
+{
+    if (l.self().length() != r.self().length()) throw std::length_error("Vector lengths mismatch");
+    return expr_dot(l.self(), r.self(), std::integral_constant<bool,
+                    TIsDenseVector<L>::value && TIsDenseVector<R>::value>());
+}
+
+template<typename L, typename R>
+TMatrixBinary<L, R, TAddOp> operator+(const TMatrixExpr<L>& l, const TMatrixExpr<R>& r)
+{
+    return TMatrixBinary<L, R, TAddOp>(l.self(), r.self());
+}
+
+template<typename L, typename R>
+TMatrixBinary<L, R, TSubOp> operator-(const TMatrixExpr<L>& l, const TMatrixExpr<R>& r)
+{
+    return TMatrixBinary<L, R, TSubOp>(l.self(), r.self());
+}
+
+template<typename E>
+TMatrixScalar<E, TMulOp> operator*(const TMatrixExpr<E>& e, const typename E::value_type& val)
+{
+    return TMatrixScalar<E, TMulOp>(e.self(), val);
+}
+
+template<typename E>
+TMatrixScalar<E, TMulOp> operator*(const typename E::value_type& val, const TMatrixExpr<E>& e)
+{
+    return TMatrixScalar<E, TMulOp>(e.self(), val);
+}
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef __TKernels_H__
+#define __TKernels_H__
+
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include "tthreadpool.h"
+#include "tsimd.h"
+
+// Low-level kernels working on raw row-major buffers with a leading dimension.
+namespace tkernels
+{
+
+// Register tile of the GEMM micro-kernel and cache blocking parameters:
+// a KC x NR panel of B stays in L1, an MC x KC block of A in L2 and
+// a KC x NC panel of B in L3.
+const size_t GEMM_MR = 4;
+const size_t GEMM_NR = 8;
+const size_t GEMM_MC = 64;
+const size_t GEMM_KC = 256;
+const size_t GEMM_NC = 1024;
+
+// Below this amount of multiply-adds packing costs more than it saves.
+const size_t GEMM_SMALL_WORK = 32 * 32 * 32;
+
+// Below this amount of multiply-adds threads cost more than they save.
+const size_t GEMM_PARALLEL_WORK = 128 * 128 * 128;
+
+// GEMV works on column blocks of this many elements, so that the block of x (or of
+// y for the transposed product) stays in L1 while every row streams past it.
+const size_t GEMV_NB = 2048;
+
+// Default size at or below which Strassen-Winograd hands over to the classical kernel.
+const size_t STRASSEN_CUTOFF = 1024;
+
+// Below this amount of multiply-adds GEMV runs on the calling thread.
+const size_t GEMV_PARALLEL_WORK = 1 << 16;
+
+// Leaf edge of the recursive transpose: a source and a destination block of this
+// size stay in L1 while their tiles are moved.
+const size_t TRANSPOSE_NB = 32;
+
+// Below this many elements a transpose runs on the calling thread.
+const size_t TRANSPOSE_PARALLEL_WORK = 1 << 16;
+
+// M * N * K <= limit, without forming the product, which may overflow size_t.
+inline bool gemm_work_at_most(size_t M, size_t N, size_t K, size_t limit) noexcept
+{
+    if (M == 0 || N == 0 || K == 0) return true;
+    return M <= limit / N && M * N <= limit / K;
+}
+
+// The GEMM kernels take their operands as op(A) and op(B), where op(X) is X or, when
+// the trans flag is set, X^T read in place from X as stored: element (i, j) of op(X)
+// is at X[i * rs + j * cs], with rs = ld, cs = 1 for X and rs = 1, cs = ld for X^T.
+inline size_t gemm_row_step(bool trans, size_t ld) noexcept { return trans ? 1 : ld; }
+
+inline size_t gemm_col_step(bool trans, size_t ld) noexcept { return trans ? ld : 1; }
+
+template<typename T>
+void gemm_naive(size_t M, size_t N, size_t K, const T* A, size_t rsa, size_t csa,
+                const T* B, size_t rsb, size_t csb, T* C, size_t ldc, bool accumulate)
+{
+    for (size_t i = 0; i < M; ++i)
+    {
+        T* c = C + i * ldc;
+        if (!accumulate) std::fill(c, c + N, T());
+        for (size_t k = 0; k < K; ++k)
+        {
+            const T a = A[i * rsa + k * csa];
+            const T* b = B + k * rsb;
+            if (csb == 1)
+            {
+                for (size_t j = 0; j < N; ++j)
+                    c[j] += a * b[j];
+            }
+            else
+            {
+                for (size_t j = 0; j < N; ++j)
+                    c[j] += a * b[j * csb];
+            }
+        }
+    }
+}
+
+// Packs an mc x kc block of op(A) into MR-row micro-panels, zero padding the tail.
+template<typename T>
+void gemm_pack_a(size_t mc, size_t kc, const T* A, size_t rs, size_t cs, T* buf)
+{
+    for (size_t i = 0; i < mc; i += GEMM_MR)
+    {
+        const size_t mr = std::min(GEMM_MR, mc - i);
+        for (size_t k = 0; k < kc; ++k)
+        {
+            for (size_t ii = 0; ii < mr; ++ii)
+                buf[ii] = A[(i + ii) * rs + k * cs];
+            for (size_t ii = mr; ii < GEMM_MR; ++ii)
+                buf[ii] = T();
+            buf += GEMM_MR;
+        }
+    }
+}
+
+// Packs a kc x nc panel of op(B) into NR-column micro-panels, zero padding the tail.
+// A transposed B is walked down its stored rows, which are the columns of op(B).
+template<typename T>
+void gemm_pack_b(size_t kc, size_t nc, const T* B, size_t rs, size_t cs, T* buf)
+{
+    for (size_t j = 0; j < nc; j += GEMM_NR)
+    {
+        const size_t nr = std::min(GEMM_NR, nc - j);
+        if (cs == 1)
+        {
+            for (size_t k = 0; k < kc; ++k)
+            {
+                const T* b = B + k * rs + j;
+                for (size_t jj = 0; jj < nr; ++jj)
+                    buf[k * GEMM_NR + jj] = b[jj];
+            }
+        }
+        else
+        {
+            for (size_t jj = 0; jj < nr; ++jj)
+            {
+                const T* b = B + (j + jj) * cs;
+                for (size_t k = 0; k < kc; ++k)
+                    buf[k * GEMM_NR + jj] = b[k * rs];
+            }
+        }
+        for (size_t k = 0; k < kc; ++k)
+            for (size_t jj = nr; jj < GEMM_NR; ++jj)
+                buf[k * GEMM_NR + jj] = T();
+        buf += kc * GEMM_NR;
+    }
+}
+
+// C[mr x nr] (+)= Ap * Bp with the whole MR x NR accumulator kept in registers.
+template<typename T>
+void gemm_micro_kernel(size_t kc, const T* Ap, const T* Bp, T* C, size_t ldc,
+                       size_t mr, size_t nr, bool accumulate)
+{
+    T acc[GEMM_MR][GEMM_NR];
+    for (size_t i = 0; i < GEMM_MR; ++i)
+        for (size_t j = 0; j < GEMM_NR; ++j)
+            acc[i][j] = T();
+
+    for (size_t k = 0; k < kc; ++k)
+    {
+        for (size_t i = 0; i < GEMM_MR; ++i)
+        {
+            const T a = Ap[i];
+            for (size_t j = 0; j < GEMM_NR; ++j)
+                acc[i][j] += a * Bp[j];
+        }
+        Ap += GEMM_MR;
+        Bp += GEMM_NR;
+    }
+
+    if (accumulate)
+    {
+        for (size_t i = 0; i < mr; ++i)
+            for (size_t j = 0; j < nr; ++j)
+                C[i * ldc + j] += acc[i][j];
+    }
+    else
+    {
+        for (size_t i = 0; i < mr; ++i)
+            for (size_t j = 0; j < nr; ++j)
+                C[i * ldc + j] = acc[i][j];
+    }
+}
+
+// C[M x N] += op(A)[M x K] * op(B)[K x N], or C = op(A) * op(B) when accumulate is
+// false; in that case C may be uninitialized, every element is written exactly once.
+template<typename T>
+void gemm(bool transA, bool transB, size_t M, size_t N, size_t K, const T* A, size_t lda,
+          const T* B, size_t ldb, T* C, size_t ldc, bool accumulate = true)
+{
+    if (M == 0 || N == 0) return;
+    const size_t rsa = gemm_row_step(transA, lda), csa = gemm_col_step(transA, lda);
+    const size_t rsb = gemm_row_step(transB, ldb), csb = gemm_col_step(transB, ldb);
+    if (gemm_work_at_most(M, N, K, GEMM_SMALL_WORK))
+    {
+        gemm_naive(M, N, K, A, rsa, csa, B, rsb, csb, C, ldc, accumulate);
+        return;
+    }
+
+    const size_t ncMax = std::min(GEMM_NC, (N + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    const size_t kcMax = std::min(GEMM_KC, K);
+    const size_t mcMax = std::min(GEMM_MC, (M + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    std::unique_ptr<T[]> packedA(new T[mcMax * kcMax]);
+    std::unique_ptr<T[]> packedB(new T[kcMax * ncMax]);
+
+    for (size_t jc = 0; jc < N; jc += GEMM_NC)
+    {
+        const size_t nc = std::min(GEMM_NC, N - jc);
+        for (size_t pc = 0; pc < K; pc += GEMM_KC)
+        {
+            const size_t kc = std::min(GEMM_KC, K - pc);
+            gemm_pack_b(kc, nc, B + pc * rsb + jc * csb, rsb, csb, packedB.get());
+
+            for (size_t ic = 0; ic < M; ic += GEMM_MC)
+            {
+                const size_t mc = std::min(GEMM_MC, M - ic);
+                gemm_pack_a(mc, kc, A + ic * rsa + pc * csa, rsa, csa, packedA.get());
+
+                for (size_t jr = 0; jr < nc; jr += GEMM_NR)
+                {
+                    const size_t nr = std::min(GEMM_NR, nc - jr);
+                    const T* Bp = packedB.get() + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += GEMM_MR)
+                    {
+                        const size_t mr = std::min(GEMM_MR, mc - ir);
+                        gemm_micro_kernel(kc, packedA.get() + ir * kc, Bp,
+                                          C + (ic + ir) * ldc + jc + jr, ldc, mr, nr,
+                                          accumulate || pc > 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// y[M] = A[M x N] * x[N]. Four rows are processed at once, so each element of x
+// loaded into a register serves four rows, and columns are blocked by GEMV_NB.
+template<typename T>
+void gemv(size_t M, size_t N, const T* A, size_t lda, const T* x, T* y)
+{
+    std::fill(y, y + M, T());
+    for (size_t jb = 0; jb < N; jb += GEMV_NB)
+    {
+        const size_t nb = std::min(GEMV_NB, N - jb);
+        const T* xb = x + jb;
+        size_t i = 0;
+        for (; i + 4 <= M; i += 4)
+        {
+            const T* a = A + i * lda + jb;
+            T r[4];
+            tsimd::dot4(nb, a, a + lda, a + 2 * lda, a + 3 * lda, xb, r);
+            y[i] += r[0];
+            y[i + 1] += r[1];
+            y[i + 2] += r[2];
+            y[i + 3] += r[3];
+        }
+        for (; i < M; ++i)
+            y[i] += tsimd::dot(nb, A + i * lda + jb, xb);
+    }
+}
+
+// Splits the rows of A across ex.
+template<typename T>
+void gemv(size_t M, size_t N, const T* A, size_t lda, const T* x, T* y, TExecutor& ex)
+{
+    if (ex.concurrency() <= 1 || gemm_work_at_most(M, N, 1, GEMV_PARALLEL_WORK))
+    {
+        gemv(M, N, A, lda, x, y);
+        return;
+    }
+    const size_t grain = std::max<size_t>(4, GEMV_PARALLEL_WORK / N) / 4 * 4;
+    parallel_ranges(ex, M, grain, [&](size_t begin, size_t end)
+    {
+        gemv(end - begin, N, A + begin * lda, lda, x, y + begin);
+    });
+}
+
+// y[N] = x[M] * A[M x N], i.e. A^T x, as a sum of rows of A scaled by x. Columns
+// are blocked by GEMV_NB so that the block of y stays in L1 across the rows.
+template<typename T>
+void gemv_t(size_t M, size_t N, const T* A, size_t lda, const T* x, T* y)
+{
+    std::fill(y, y + N, T());
+    for (size_t jb = 0; jb < N; jb += GEMV_NB)
+    {
+        const size_t nb = std::min(GEMV_NB, N - jb);
+        for (size_t i = 0; i < M; ++i)
+            tsimd::axpy(nb, x[i], A + i * lda + jb, y + jb);
+    }
+}
+
+// Splits the columns of A across ex, so that every thread owns a part of y.
+template<typename T>
+void gemv_t(size_t M, size_t N, const T* A, size_t lda, const T* x, T* y, TExecutor& ex)
+{
+    if (ex.concurrency() <= 1 || gemm_work_at_most(M, N, 1, GEMV_PARALLEL_WORK))
+    {
+        gemv_t(M, N, A, lda, x, y);
+        return;
+    }
+    const size_t grain = std::max<size_t>(64, GEMV_PARALLEL_WORK / M) / 64 * 64;
+    parallel_ranges(ex, N, grain, [&](size_t begin, size_t end)
+    {
+        gemv_t(M, end - begin, A + begin, lda, x, y + begin);
+    });
+}
+
+// C[M x N] += A[M x K] * B[K x N], both row-major as stored.
+template<typename T>
+void gemm(size_t M, size_t N, size_t K, const T* A, size_t lda,
+          const T* B, size_t ldb, T* C, size_t ldc, bool accumulate = true)
+{
+    gemm(false, false, M, N, K, A, lda, B, ldb, C, ldc, accumulate);
+}
+
+// Splits C into row/column tiles and runs the serial kernel on each tile through ex.
+template<typename T>
+void gemm(bool transA, bool transB, size_t M, size_t N, size_t K, const T* A, size_t lda,
+          const T* B, size_t ldb, T* C, size_t ldc, TExecutor& ex, bool accumulate = true)
+{
+    const size_t nThreads = ex.concurrency();
+    if (nThreads <= 1 || gemm_work_at_most(M, N, K, GEMM_PARALLEL_WORK))
+    {
+        gemm(transA, transB, M, N, K, A, lda, B, ldb, C, ldc, accumulate);
+        return;
+    }
+
+    const size_t targetTiles = 4 * nThreads;
+    const size_t rowTiles = std::min((M + GEMM_MC - 1) / GEMM_MC, targetTiles);
+    const size_t colTiles = std::min((N + GEMM_NR - 1) / GEMM_NR,
+                                     (targetTiles + rowTiles - 1) / rowTiles);
+    const size_t tileM = ((M + rowTiles - 1) / rowTiles + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    const size_t tileN = ((N + colTiles - 1) / colTiles + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    const size_t nRowTiles = (M + tileM - 1) / tileM;
+    const size_t nColTiles = (N + tileN - 1) / tileN;
+
+    ex.parallel_for(nRowTiles * nColTiles, [&](size_t t)
+    {
+        const size_t i = t / nColTiles * tileM;
+        const size_t j = t % nColTiles * tileN;
+        gemm(transA, transB, std::min(tileM, M - i), std::min(tileN, N - j), K,
+             A + i * gemm_row_step(transA, lda), lda, B + j * gemm_col_step(transB, ldb), ldb,
+             C + i * ldc + j, ldc, accumulate);
+    });
+}
+
+template<typename T>
+void gemm(size_t M, size_t N, size_t K, const T* A, size_t lda,
+          const T* B, size_t ldb, T* C, size_t ldc, TExecutor& ex, bool accumulate = true)
+{
+    gemm(false, false, M, N, K, A, lda, B, ldb, C, ldc, ex, accumulate);
+}
+
+
+// C = A + B and C = A - B on M x N blocks with leading dimensions; C may alias A or B.
+template<typename T>
+void block_add(size_t M, size_t N, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc)
+{
+    for (size_t i = 0; i < M; ++i)
+        tsimd::add(N, A + i * lda, B + i * ldb, C + i * ldc);
+}
+
+template<typename T>
+void block_sub(size_t M, size_t N, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc)
+{
+    for (size_t i = 0; i < M; ++i)
+        tsimd::sub(N, A + i * lda, B + i * ldb, C + i * ldc);
+}
+
+// Scratch elements strassen() needs for an n x n product: three half-size
+// temporaries per level of recursion, n^2 in total.
+inline size_t strassen_workspace(size_t n, size_t cutoff) noexcept
+{
+    size_t total = 0;
+    while (n > cutoff && n > 1)
+    {
+        if (n % 2 == 1) --n;
+        n /= 2;
+        total += 3 * n * n;
+    }
+    return total;
+}
+
+// C = A * B for n x n matrices by Strassen-Winograd: 7 half-size products and 15
+// block additions per level instead of 8 products, O(n^2.81) overall. Blocks of
+// size cutoff or less use the classical kernel through ex. An odd n is peeled:
+// the even leading part recurses and the last row and column are fixed up with
+// thin classical products. ws holds strassen_workspace(n, cutoff) elements and
+// is reused by every level, so the recursion does not allocate.
+//
+// Rounding errors grow somewhat faster than for the classical product, since
+// the additions mix blocks of different magnitude.
+template<typename T>
+void strassen(size_t n, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc,
+              size_t cutoff, T* ws, TExecutor& ex)
+{
+    if (n <= cutoff || n <= 1)
+    {
+        gemm(n, n, n, A, lda, B, ldb, C, ldc, ex, false);
+        return;
+    }
+    if (n % 2 == 1)
+    {
+        const size_t m = n - 1;
+        strassen(m, A, lda, B, ldb, C, ldc, cutoff, ws, ex);
+        gemm(m, m, 1, A + m, lda, B + m * ldb, ldb, C, ldc, ex, true);
+        gemm(m, 1, n, A, lda, B + m, ldb, C + m, ldc, ex, false);
+        gemm(1, n, n, A + m * lda, lda, B, ldb, C + m * ldc, ldc, ex, false);
+        return;
+    }
+
+    const size_t h = n / 2;
+    const T *A11 = A, *A12 = A + h, *A21 = A + h * lda, *A22 = A + h * lda + h;
+    const T *B11 = B, *B12 = B + h, *B21 = B + h * ldb, *B22 = B + h * ldb + h;
+    T *C11 = C, *C12 = C + h, *C21 = C + h * ldc, *C22 = C + h * ldc + h;
+    T *X = ws, *Y = ws + h * h, *Z = ws + 2 * h * h, *next = ws + 3 * h * h;
+
+    block_sub(h, h, A11, lda, A21, lda, X, h);          // S3 = A11 - A21
+    block_sub(h, h, B22, ldb, B12, ldb, Y, h);          // T3 = B22 - B12
+    strassen(h, X, h, Y, h, C21, ldc, cutoff, next, ex); // P7 = S3 T3
+    block_add(h, h, A21, lda, A22, lda, X, h);          // S1 = A21 + A22
+    block_sub(h, h, B12, ldb, B11, ldb, Y, h);          // T1 = B12 - B11
+    strassen(h, X, h, Y, h, C22, ldc, cutoff, next, ex); // P5 = S1 T1
+    block_sub(h, h, X, h, A11, lda, X, h);              // S2 = S1 - A11
+    block_sub(h, h, B22, ldb, Y, h, Y, h);              // T2 = B22 - T1
+    strassen(h, X, h, Y, h, C12, ldc, cutoff, next, ex); // P6 = S2 T2
+    strassen(h, A11, lda, B11, ldb, Z, h, cutoff, next, ex); // P1 = A11 B11
+    block_add(h, h, C12, ldc, Z, h, C12, ldc);          // U2 = P1 + P6
+    block_add(h, h, C21, ldc, C12, ldc, C21, ldc);      // U3 = U2 + P7
+    block_add(h, h, C12, ldc, C22, ldc, C12, ldc);      // U4 = U2 + P5
+    block_add(h, h, C22, ldc, C21, ldc, C22, ldc);      // C22 = U3 + P5
+    block_sub(h, h, A12, lda, X, h, X, h);              // S4 = A12 - S2
+    strassen(h, X, h, B22, ldb, C11, ldc, cutoff, next, ex); // P3 = S4 B22
+    block_add(h, h, C12, ldc, C11, ldc, C12, ldc);      // C12 = U4 + P3
+    block_sub(h, h, Y, h, B21, ldb, Y, h);              // T4 = T2 - B21
+    strassen(h, A22, lda, Y, h, C11, ldc, cutoff, next, ex); // P4 = A22 T4
+    block_sub(h, h, C21, ldc, C11, ldc, C21, ldc);      // C21 = U3 - P4
+    strassen(h, A12, lda, B21, ldb, C11, ldc, cutoff, next, ex); // P2 = A12 B21
+    block_add(h, h, C11, ldc, Z, h, C11, ldc);          // C11 = P1 + P2
+}
+
+// B[N x M] = A[M x N]^T for a block that fits in L1: vector tiles where the type has
+// them, element by element along the edges.
+template<typename T>
+void transpose_leaf(size_t M, size_t N, const T* A, size_t lda, T* B, size_t ldb)
+{
+    const size_t t = tsimd::transpose_tile_size<T>();
+    size_t i = 0;
+    if (t != 0)
+    {
+        for (; i + t <= M; i += t)
+        {
+            size_t j = 0;
+            for (; j + t <= N; j += t)
+                tsimd::transpose_tile(A + i * lda + j, lda, B + j * ldb + i, ldb);
+            for (size_t ii = i; ii < i + t; ++ii)
+                for (size_t jj = j; jj < N; ++jj)
+                    B[jj * ldb + ii] = A[ii * lda + jj];
+        }
+    }
+    for (; i < M; ++i)
+        for (size_t j = 0; j < N; ++j)
+            B[j * ldb + i] = A[i * lda + j];
+}
+
+// B[N x M] = A[M x N]^T, where A and B do not overlap. Cache-oblivious: the longer
+// side is halved until the block fits TRANSPOSE_NB, so the blocks fit every cache
+// level without tuning for any. Splits are multiples of 8 to keep the tiles whole.
+template<typename T>
+void transpose(size_t M, size_t N, const T* A, size_t lda, T* B, size_t ldb)
+{
+    if (M <= TRANSPOSE_NB && N <= TRANSPOSE_NB)
+    {
+        transpose_leaf(M, N, A, lda, B, ldb);
+        return;
+    }
+    if (M >= N)
+    {
+        const size_t h = M / 2 / 8 * 8;
+        transpose(h, N, A, lda, B, ldb);
+        transpose(M - h, N, A + h * lda, lda, B + h, ldb);
+    }
+    else
+    {
+        const size_t h = N / 2 / 8 * 8;
+        transpose(M, h, A, lda, B, ldb);
+        transpose(M, N - h, A + h, lda, B + h * ldb, ldb);
+    }
+}
+
+// Splits the rows of A, i.e. the columns of B, across ex.
+template<typename T>
+void transpose(size_t M, size_t N, const T* A, size_t lda, T* B, size_t ldb, TExecutor& ex)
+{
+    if (ex.concurrency() <= 1 || gemm_work_at_most(M, N, 1, TRANSPOSE_PARALLEL_WORK))
+    {
+        transpose(M, N, A, lda, B, ldb);
+        return;
+    }
+    const size_t grain = std::max(TRANSPOSE_NB, TRANSPOSE_PARALLEL_WORK / N / TRANSPOSE_NB * TRANSPOSE_NB);
+    parallel_ranges(ex, M, grain, [&](size_t begin, size_t end)
+    {
+        transpose(end - begin, N, A + begin * lda, lda, B + begin, ldb);
+    });
+}
+
+// One block row of the in-place transpose: the diagonal block is transposed by
+// swaps, and every mirrored pair P = (ib, jb), Q = (jb, ib) with jb > ib is exchanged
+// through one block-sized buffer: P^T goes to the buffer, Q^T over P, the buffer
+// over Q. Different block rows touch disjoint blocks.
+template<typename T>
+void transpose_block_row(size_t N, T* A, size_t lda, size_t ib, T* buf)
+{
+    const size_t mb = std::min(TRANSPOSE_NB, N - ib);
+    for (size_t i = 0; i < mb; ++i)
+        for (size_t j = i + 1; j < mb; ++j)
+            std::swap(A[(ib + i) * lda + ib + j], A[(ib + j) * lda + ib + i]);
+
+    for (size_t jb = ib + mb; jb < N; jb += TRANSPOSE_NB)
+    {
+        const size_t nb = std::min(TRANSPOSE_NB, N - jb);
+        T* P = A + ib * lda + jb;
+        T* Q = A + jb * lda + ib;
+        transpose_leaf(mb, nb, P, lda, buf, mb);
+        transpose_leaf(nb, mb, Q, lda, P, lda);
+        for (size_t r = 0; r < nb; ++r)
+            std::copy(buf + r * mb, buf + (r + 1) * mb, Q + r * lda);
+    }
+}
+
+// A = A^T for a square N x N A.
+template<typename T>
+void transpose_inplace(size_t N, T* A, size_t lda)
+{
+    std::unique_ptr<T[]> buf(new T[TRANSPOSE_NB * TRANSPOSE_NB]);
+    for (size_t ib = 0; ib < N; ib += TRANSPOSE_NB)
+        transpose_block_row(N, A, lda, ib, buf.get());
+}
+
+// Block rows go to ex; their cost falls from the first to the last.
+template<typename T>
+void transpose_inplace(size_t N, T* A, size_t lda, TExecutor& ex)
+{
+    if (ex.concurrency() <= 1 || gemm_work_at_most(N, N, 1, TRANSPOSE_PARALLEL_WORK))
+    {
+        transpose_inplace(N, A, lda);
+        return;
+    }
+    ex.parallel_for((N + TRANSPOSE_NB - 1) / TRANSPOSE_NB, [&](size_t b)
+    {
+        std::unique_ptr<T[]> buf(new T[TRANSPOSE_NB * TRANSPOSE_NB]);
+        transpose_block_row(N, A, lda, b * TRANSPOSE_NB, buf.get());
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,779 @@
+#ifndef __TLinalg_H__
+#define __TLinalg_H__
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "tmatrix.h"
+
+// Dense factorizations of TDynamicMatrix. Each one is an object built once from the
+// matrix and then reused for any number of right-hand sides.
+
+// Panel width of the blocked factorizations: the panel is factored column by
+// column, and everything right of it is updated by one GEMM per panel.
+const size_t FACTOR_BLOCK = 64;
+
+// P A = L U with partial pivoting, L unit lower triangular and U upper triangular,
+// both kept in one matrix. The factorization is blocked right-looking: a panel of
+// FACTOR_BLOCK columns is factored, the rows of U to its right are solved against it,
+// and the trailing submatrix is updated with a single GEMM, which holds almost all
+// of the n^3 / 3 multiply-adds and is spread across the executor.
+//
+// Rounding leaves a pivot of a singular matrix at about eps * max|a_ij| rather than
+// exactly zero, so a pivot counts as zero once |u_jj| <= n * eps * max|a_ij|. Such
+// a pivot does not stop the factorization: the matrix is marked singular,
+// determinant() is 0, and solve() and inverse() throw.
+template<typename T>
+class TLUDecomposition
+{
+protected:
+    TDynamicMatrix<T> lu;
+    std::vector<size_t> pivots;
+    bool negated;
+    bool singular;
+    T tolerance;
+
+    bool negligible(const T& pivot) const noexcept
+    {
+        return std::abs(pivot) <= tolerance;
+    }
+
+    // Unblocked factorization of columns [k0, k1) for rows k0..n-1. Rows are swapped
+    // across the whole matrix, so the columns outside the panel follow along.
+    void factor_panel(size_t k0, size_t k1)
+    {
+        const size_t n = lu.rows(), lda = lu.get_stride();
+        T* a = lu.data();
+        for (size_t j = k0; j < k1; ++j)
+        {
+            size_t p = j;
+            for (size_t i = j + 1; i < n; ++i)
+                if (std::abs(a[i * lda + j]) > std::abs(a[p * lda + j])) p = i;
+            pivots[j] = p;
+            if (p != j)
+            {
+                std::swap_ranges(a + j * lda, a + j * lda + n, a + p * lda);
+                negated = !negated;
+            }
+
+            const T pivot = a[j * lda + j];
+            if (negligible(pivot))
+            {
+                singular = true;
+                continue;
+            }
+            for (size_t i = j + 1; i < n; ++i)
+            {
+                T* row = a + i * lda;
+                row[j] /= pivot;
+                tsimd::axpy(k1 - j - 1, -row[j], a + j * lda + j + 1, row + j + 1);
+            }
+        }
+    }
+
+    // U12 = L11^-1 A12 for the rows of the panel, then A22 -= L21 U12.
+    void update_trailing(size_t k0, size_t k1, T* negU, TExecutor& ex)
+    {
+        const size_t n = lu.rows(), lda = lu.get_stride(), nb = k1 - k0, nt = n - k1;
+        T* a = lu.data();
+        for (size_t i = k0 + 1; i < k1; ++i)
+            for (size_t k = k0; k < i; ++k)
+                tsimd::axpy(nt, -a[i * lda + k], a + k * lda + k1, a + i * lda + k1);
+
+        for (size_t i = 0; i < nb; ++i)
+            tsimd::scale(nt, a + (k0 + i) * lda + k1, T(-1), negU + i * nt);
+        tkernels::gemm(nt, nt, nb, a + k1 * lda + k0, lda, negU, nt, a + k1 * lda + k1, lda, ex, true);
+    }
+
+    void check_solvable(size_t rows) const
+    {
+        if (rows != lu.rows()) throw length_error("Vector and Matrix dimensions incompatible");
+        if (singular) throw runtime_error("Matrix is singular");
+    }
+
+public:
+    explicit TLUDecomposition(const TDynamicMatrix<T>& a, TExecutor& ex = matrix_executor())
+        : lu(a), pivots(a.rows()), negated(false), singular(false), tolerance()
+    {
+        if (!a.is_square()) throw length_error("LU decomposition requires a square matrix");
+
+        const size_t n = lu.rows();
+        T amax = T();
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j)
+                amax = std::max<T>(amax, std::abs(a(i, j)));
+        tolerance = T(n) * std::numeric_limits<T>::epsilon() * amax;
+        std::unique_ptr<T[]> negU(new T[std::min(FACTOR_BLOCK, n) * n]);
+        for (size_t k0 = 0; k0 < n; k0 += FACTOR_BLOCK)
+        {
+            const size_t k1 = std::min(n, k0 + FACTOR_BLOCK);
+            factor_panel(k0, k1);
+            if (k1 < n) update_trailing(k0, k1, negU.get(), ex);
+        }
+    }
+
+    size_t size() const noexcept { return lu.rows(); }
+
+    // L strictly below the diagonal, U on and above it.
+    const TDynamicMatrix<T>& factors() const noexcept { return lu; }
+
+    // Step i swapped row i with row pivot_rows()[i] >= i.
+    const std::vector<size_t>& pivot_rows() const noexcept { return pivots; }
+
+    // Some pivot was within singularity_tolerance() of zero.
+    bool is_singular() const noexcept { return singular; }
+
+    // n * eps * max|a_ij|; pivots no larger in magnitude count as zero.
+    T singularity_tolerance() const noexcept { return tolerance; }
+
+    T determinant() const
+    {
+        if (singular) return T();
+        T det = negated ? T(-1) : T(1);
+        for (size_t i = 0; i < lu.rows(); ++i) det *= lu(i, i);
+        return det;
+    }
+
+    // x with A x = b: the row swaps, then forward and back substitution, each a dot
+    // product along a row of the factors.
+    TDynamicVector<T> solve(const TDynamicVector<T>& b) const
+    {
+        check_solvable(b.length());
+
+        const size_t n = lu.rows(), lda = lu.get_stride();
+        const T* a = lu.data();
+        TDynamicVector<T> x(b);
+        T* px = x.data();
+        for (size_t i = 0; i < n; ++i) std::swap(px[i], px[pivots[i]]);
+        for (size_t i = 1; i < n; ++i)
+            px[i] -= tsimd::dot(i, a + i * lda, px);
+        for (size_t i = n; i-- > 0;)
+            px[i] = (px[i] - tsimd::dot(n - i - 1, a + i * lda + i + 1, px + i + 1)) / a[i * lda + i];
+        return x;
+    }
+
+    // X with A X = B for every column of B at once; column ranges of X are
+    // independent and run on matrix_executor().
+    TDynamicMatrix<T> solve(const TDynamicMatrix<T>& b) const
+    {
+        check_solvable(b.rows());
+
+        const size_t n = lu.rows(), m = b.cols(), lda = lu.get_stride();
+        const T* a = lu.data();
+        TDynamicMatrix<T> x(b);
+        T* px = x.data();
+        const size_t ldx = x.get_stride();
+        for (size_t i = 0; i < n; ++i)
+            if (pivots[i] != i) std::swap_ranges(px + i * ldx, px + i * ldx + m, px + pivots[i] * ldx);
+
+        run_ranges(m, std::max<size_t>(1, PARALLEL_GRAIN / n), [&](size_t begin, size_t end)
+        {
+            const size_t w = end - begin;
+            for (size_t i = 1; i < n; ++i)
+                for (size_t k = 0; k < i; ++k)
+                    tsimd::axpy(w, -a[i * lda + k], px + k * ldx + begin, px + i * ldx + begin);
+            for (size_t i = n; i-- > 0;)
+            {
+                T* xi = px + i * ldx + begin;
+                for (size_t k = i + 1; k < n; ++k)
+                    tsimd::axpy(w, -a[i * lda + k], px + k * ldx + begin, xi);
+                tsimd::scale(w, xi, T(1) / a[i * lda + i], xi);
+            }
+        });
+        return x;
+    }
+
+    TDynamicMatrix<T> inverse() const
+    {
+        const size_t n = lu.rows();
+        TDynamicMatrix<T> identity(n);
+        for (size_t i = 0; i < n; ++i) identity(i, i) = T(1);
+        return solve(identity);
+    }
+};
+
+// A = L D L^T for a symmetric A, L unit lower triangular and D diagonal. Only the
+// lower triangle of A is read. Without pivoting this is stable for positive
+// definite matrices, which is what the two factorizations below are for.
+//
+// The factorization is blocked right-looking like the LU one. Each panel of
+// FACTOR_BLOCK columns is factored: first its diagonal block, then the rows below
+// it, which are independent of each other. The trailing submatrix is then updated
+// by A22 -= L21 D1 L21^T, restricted to the lower triangle. That update is a set of
+// row-block GEMM tiles run on the executor, so about n^3 / 6 multiply-adds are done
+// instead of the n^3 / 3 of LU.
+template<typename T>
+class TSymmetricFactorization
+{
+protected:
+    TDynamicMatrix<T> l;
+    TDynamicVector<T> d;
+    T tolerance;
+
+    // A pivot is checked as soon as it is known; check(d, tolerance) throws for one
+    // that the factorization does not accept. tolerance is n * eps * max|a_ii|: a
+    // rank deficient matrix leaves a pivot of about that size after rounding rather
+    // than an exact zero.
+    template<typename Check>
+    TSymmetricFactorization(const TDynamicMatrix<T>& a, TExecutor& ex, const Check& check)
+        : l(a.rows(), a.cols()), d(a.rows()), tolerance()
+    {
+        if (!a.is_square()) throw length_error("Symmetric decomposition requires a square matrix");
+
+        const size_t n = l.rows();
+        T amax = T();
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(a.row_data(i), a.row_data(i) + i + 1, l.row_data(i));
+            amax = std::max<T>(amax, std::abs(a(i, i)));
+        }
+        tolerance = T(n) * std::numeric_limits<T>::epsilon() * amax;
+
+        const size_t nb = std::min(FACTOR_BLOCK, n);
+        std::unique_ptr<T[]> w(new T[nb * nb]);
+        std::unique_ptr<T[]> negW(new T[(n - nb) * nb + 1]);
+        for (size_t k0 = 0; k0 < n; k0 += FACTOR_BLOCK)
+        {
+            const size_t k1 = std::min(n, k0 + FACTOR_BLOCK);
+            factor_diagonal_block(k0, k1, w.get(), check);
+            if (k1 < n)
+            {
+                factor_panel_rows(k0, k1, w.get(), negW.get(), ex);
+                update_trailing(k0, k1, negW.get(), ex);
+            }
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            T* row = l.row_data(i);
+            row[i] = T(1);
+            std::fill(row + i + 1, row + n, T());
+        }
+    }
+
+    // Columns [k0, k1) of the diagonal block, one column at a time. Row j of w gets
+    // L(j, k) * d[k] for k in [k0, j), which the rows below the panel reuse.
+    template<typename Check>
+    void factor_diagonal_block(size_t k0, size_t k1, T* w, const Check& check)
+    {
+        const size_t lda = l.get_stride(), nb = k1 - k0;
+        T* a = l.data();
+        for (size_t j = k0; j < k1; ++j)
+        {
+            const T* rowj = a + j * lda + k0;
+            T* wj = w + (j - k0) * nb;
+            for (size_t k = 0; k < j - k0; ++k) wj[k] = rowj[k] * d[k0 + k];
+
+            const T dj = a[j * lda + j] - tsimd::dot(j - k0, wj, rowj);
+            check(dj, tolerance);
+            d[j] = dj;
+            for (size_t i = j + 1; i < k1; ++i)
+            {
+                T* rowi = a + i * lda;
+                rowi[j] = (rowi[j] - tsimd::dot(j - k0, rowi + k0, wj)) / dj;
+            }
+        }
+    }
+
+    // L21 = A21 L11^-T D1^-1, row by row, and negW = -L21 D1 for the trailing update.
+    void factor_panel_rows(size_t k0, size_t k1, const T* w, T* negW, TExecutor& ex)
+    {
+        const size_t n = l.rows(), lda = l.get_stride(), nb = k1 - k0;
+        T* a = l.data();
+        parallel_ranges(ex, n - k1, std::max<size_t>(1, PARALLEL_GRAIN / (nb * nb)),
+                        [&](size_t begin, size_t end)
+        {
+            for (size_t i = k1 + begin; i < k1 + end; ++i)
+            {
+                T* rowi = a + i * lda + k0;
+                T* negWi = negW + (i - k1) * nb;
+                for (size_t j = 0; j < nb; ++j)
+                {
+                    rowi[j] = (rowi[j] - tsimd::dot(j, rowi, w + j * nb)) / d[k0 + j];
+                    negWi[j] = -rowi[j] * d[k0 + j];
+                }
+            }
+        });
+    }
+
+    // A22 += negW L21^T on and below the diagonal. Row block [r0, r1) needs columns
+    // [k1, r1) only; the few elements above the diagonal of its last tile are
+    // cleared at the end. The largest tiles are handed out first.
+    void update_trailing(size_t k0, size_t k1, const T* negW, TExecutor& ex)
+    {
+        const size_t n = l.rows(), lda = l.get_stride(), nb = k1 - k0, nt = n - k1;
+        const size_t nTiles = (nt + FACTOR_BLOCK - 1) / FACTOR_BLOCK;
+        T* a = l.data();
+        auto tile = [&](size_t t)
+        {
+            const size_t r0 = k1 + (nTiles - 1 - t) * FACTOR_BLOCK;
+            const size_t r1 = std::min(n, r0 + FACTOR_BLOCK);
+            tkernels::gemm(false, true, r1 - r0, r1 - k1, nb, negW + (r0 - k1) * nb, nb,
+                           a + k1 * lda + k0, lda, a + r0 * lda + k1, lda, true);
+        };
+        if (ex.concurrency() <= 1 || tkernels::gemm_work_at_most(nt, nt, nb, tkernels::GEMM_PARALLEL_WORK))
+            for (size_t t = 0; t < nTiles; ++t) tile(t);
+        else
+            ex.parallel_for(nTiles, tile);
+    }
+
+    void check_solvable(size_t rows) const
+    {
+        if (rows != l.rows()) throw length_error("Vector and Matrix dimensions incompatible");
+    }
+
+public:
+    size_t size() const noexcept { return l.rows(); }
+
+    // n * eps * max|a_ii|; pivots no larger in magnitude were rejected.
+    T pivot_tolerance() const noexcept { return tolerance; }
+
+    T determinant() const
+    {
+        T det = T(1);
+        for (size_t i = 0; i < d.length(); ++i) det *= d[i];
+        return det;
+    }
+
+    // x with A x = b: L y = b forward, z = D^-1 y, then L^T x = z backward. L^T is
+    // applied one row of L at a time, so both sweeps read L contiguously.
+    TDynamicVector<T> solve(const TDynamicVector<T>& b) const
+    {
+        check_solvable(b.length());
+
+        const size_t n = l.rows(), lda = l.get_stride();
+        const T* a = l.data();
+        TDynamicVector<T> x(b);
+        T* px = x.data();
+        for (size_t i = 1; i < n; ++i)
+            px[i] -= tsimd::dot(i, a + i * lda, px);
+        for (size_t i = 0; i < n; ++i)
+            px[i] /= d[i];
+        for (size_t i = n; i-- > 1;)
+            tsimd::axpy(i, -px[i], a + i * lda, px);
+        return x;
+    }
+
+    // X with A X = B for every column of B at once; column ranges of X are
+    // independent and run on matrix_executor().
+    TDynamicMatrix<T> solve(const TDynamicMatrix<T>& b) const
+    {
+        check_solvable(b.rows());
+
+        const size_t n = l.rows(), m = b.cols(), lda = l.get_stride();
+        const T* a = l.data();
+        TDynamicMatrix<T> x(b);
+        T* px = x.data();
+        const size_t ldx = x.get_stride();
+        run_ranges(m, std::max<size_t>(1, PARALLEL_GRAIN / n), [&](size_t begin, size_t end)
+        {
+            const size_t w = end - begin;
+            for (size_t i = 1; i < n; ++i)
+                for (size_t k = 0; k < i; ++k)
+                    tsimd::axpy(w, -a[i * lda + k], px + k * ldx + begin, px + i * ldx + begin);
+            for (size_t i = 0; i < n; ++i)
+                tsimd::scale(w, px + i * ldx + begin, T(1) / d[i], px + i * ldx + begin);
+            for (size_t i = n; i-- > 1;)
+                for (size_t k = 0; k < i; ++k)
+                    tsimd::axpy(w, -a[i * lda + k], px + i * ldx + begin, px + k * ldx + begin);
+        });
+        return x;
+    }
+
+    TDynamicMatrix<T> inverse() const
+    {
+        const size_t n = l.rows();
+        TDynamicMatrix<T> identity(n);
+        for (size_t i = 0; i < n; ++i) identity(i, i) = T(1);
+        return solve(identity);
+    }
+};
+
+// A = L D L^T. No square roots are taken, and a symmetric indefinite matrix is
+// accepted as long as no pivot comes out within pivot_tolerance() of zero, which
+// throws.
+template<typename T>
+class TLDLTDecomposition : public TSymmetricFactorization<T>
+{
+public:
+    explicit TLDLTDecomposition(const TDynamicMatrix<T>& a, TExecutor& ex = matrix_executor())
+        : TSymmetricFactorization<T>(a, ex, [](const T& dj, const T& tolerance)
+          {
+              if (std::abs(dj) <= tolerance) throw runtime_error("Zero pivot in LDLT decomposition");
+          })
+    {
+    }
+
+    // Unit lower triangular L, zero above the diagonal.
+    const TDynamicMatrix<T>& unit_lower() const noexcept { return this->l; }
+
+    const TDynamicVector<T>& diagonal() const noexcept { return this->d; }
+
+    bool is_positive_definite() const noexcept
+    {
+        for (size_t i = 0; i < this->d.length(); ++i)
+            if (!(this->d[i] > T())) return false;
+        return true;
+    }
+};
+
+// A = L L^T for a symmetric positive definite A, computed as L D L^T with
+// L = L_unit D^1/2. The first pivot not above pivot_tolerance() throws, so a matrix
+// that is not numerically positive definite is rejected without finishing the
+// factorization.
+template<typename T>
+class TCholeskyDecomposition : public TSymmetricFactorization<T>
+{
+public:
+    explicit TCholeskyDecomposition(const TDynamicMatrix<T>& a, TExecutor& ex = matrix_executor())
+        : TSymmetricFactorization<T>(a, ex, [](const T& dj, const T& tolerance)
+          {
+              if (!(dj > tolerance)) throw runtime_error("Matrix is not positive definite");
+          })
+    {
+    }
+
+    // The Cholesky factor L, zero above the diagonal.
+    TDynamicMatrix<T> lower() const
+    {
+        const size_t n = this->l.rows();
+        TDynamicMatrix<T> res(this->l);
+        TDynamicVector<T> s(n, uninitialized);
+        for (size_t j = 0; j < n; ++j) s[j] = std::sqrt(this->d[j]);
+        for (size_t i = 0; i < n; ++i)
+        {
+            T* row = res.row_data(i);
+            for (size_t j = 0; j <= i; ++j) row[j] *= s[j];
+        }
+        return res;
+    }
+
+    // log det A, which does not overflow for large covariance matrices.
+    T log_determinant() const
+    {
+        T res = T();
+        for (size_t i = 0; i < this->d.length(); ++i) res += std::log(this->d[i]);
+        return res;
+    }
+};
+
+// A TSQR block has at least this many rows, and at least twice as many as columns.
+const size_t TSQR_MIN_BLOCK_ROWS = 256;
+
+// lstsq() switches to TSQR for matrices at least this many times taller than wide.
+const size_t TSQR_ASPECT = 8;
+
+// A = Q R for an m x n matrix with m >= n, Q = H_0 H_1 ... H_{n-1} a product of
+// Householder reflectors H_j = I - tau_j v_j v_j^T and R upper triangular. R is kept
+// on and above the diagonal, and v_j below it, with its leading 1 implied.
+//
+// The factorization is blocked with the compact WY representation: the reflectors
+// of a panel of FACTOR_BLOCK columns combine into I - V T V^T with T upper
+// triangular, and the trailing columns are updated by A2 -= V (T^T (V^T A2)). The
+// two large products are GEMMs on the executor, so the panel, which is only
+// O(m FACTOR_BLOCK^2) per panel, is the only part done vector by vector.
+//
+// A numerically rank-deficient A leaves some R(i, i) at rounding level rather than
+// zero, so A counts as rank deficient once |R(i, i)| <= m * eps * max|R(j, j)|.
+template<typename T>
+class TQRDecomposition
+{
+protected:
+    TDynamicMatrix<T> qr;
+    TDynamicVector<T> tau;
+    T tolerance;
+
+    // Reflector of column j, rows j..m-1, chosen as in LAPACK xLARFG so that
+    // beta = -sign(alpha) ||x|| and no cancellation occurs.
+    void make_reflector(size_t j)
+    {
+        const size_t m = qr.rows(), lda = qr.get_stride();
+        T* a = qr.data() + j * lda + j;
+        T sigma = T();
+        for (size_t i = 1; i < m - j; ++i) sigma += a[i * lda] * a[i * lda];
+        if (sigma == T())
+        {
+            tau[j] = T();
+            return;
+        }
+
+        const T alpha = a[0];
+        const T norm = std::sqrt(alpha * alpha + sigma);
+        const T beta = alpha > T() ? -norm : norm;
+        tau[j] = (beta - alpha) / beta;
+        const T s = T(1) / (alpha - beta);
+        for (size_t i = 1; i < m - j; ++i) a[i * lda] *= s;
+        a[0] = beta;
+    }
+
+    // Unblocked factorization of columns [k0, k1). Each reflector is applied to
+    // the rest of the panel a row at a time: w = v^T A, then A -= tau v w.
+    void factor_panel(size_t k0, size_t k1, T* w)
+    {
+        const size_t m = qr.rows(), lda = qr.get_stride();
+        T* a = qr.data();
+        for (size_t j = k0; j < k1; ++j)
+        {
+            make_reflector(j);
+            const size_t len = k1 - j - 1;
+            if (tau[j] == T() || len == 0) continue;
+
+            std::copy(a + j * lda + j + 1, a + j * lda + k1, w);
+            for (size_t i = j + 1; i < m; ++i)
+                tsimd::axpy(len, a[i * lda + j], a + i * lda + j + 1, w);
+            tsimd::axpy(len, -tau[j], w, a + j * lda + j + 1);
+            for (size_t i = j + 1; i < m; ++i)
+                tsimd::axpy(len, -tau[j] * a[i * lda + j], w, a + i * lda + j + 1);
+        }
+    }
+
+    // Q^T A for the trailing columns [k1, n) through the compact WY form of the
+    // panel. v holds V explicitly, (m - k0) x nb with ones on the diagonal, and t
+    // gets -T.
+    void update_trailing(size_t k0, size_t k1, T* v, T* t, T* w, T* tw, TExecutor& ex)
+    {
+        const size_t m = qr.rows(), n = qr.cols(), lda = qr.get_stride();
+        const size_t nb = k1 - k0, mk = m - k0, nt = n - k1;
+        T* a = qr.data();
+
+        for (size_t r = 0; r < mk; ++r)
+        {
+            T* vr = v + r * nb;
+            if (r < nb)
+            {
+                std::copy(a + (k0 + r) * lda + k0, a + (k0 + r) * lda + k0 + r, vr);
+                vr[r] = T(1);
+                std::fill(vr + r + 1, vr + nb, T());
+            }
+            else
+                std::copy(a + (k0 + r) * lda + k0, a + (k0 + r) * lda + k1, vr);
+        }
+
+        // T(0:j, j) = -tau_j T(0:j, 0:j) V(:, 0:j)^T v_j, with z = V(:, 0:j)^T v_j
+        // kept in w, which is free until the trailing update.
+        std::fill(t, t + nb * nb, T());
+        for (size_t j = 0; j < nb; ++j)
+        {
+            T* z = w;
+            std::fill(z, z + j, T());
+            for (size_t r = j; r < mk; ++r)
+                tsimd::axpy(j, v[r * nb + j], v + r * nb, z);
+            for (size_t i = 0; i < j; ++i)
+                t[i * nb + j] = -tau[k0 + j] * tsimd::dot(j - i, t + i * nb + i, z + i);
+            t[j * nb + j] = tau[k0 + j];
+        }
+        tsimd::scale(nb * nb, t, T(-1), t);
+
+        T* a2 = a + k0 * lda + k1;
+        tkernels::gemm(true, false, nb, nt, mk, v, nb, a2, lda, w, nt, ex, false);
+        tkernels::gemm(true, false, nb, nt, nb, t, nb, w, nt, tw, nt, false);
+        tkernels::gemm(false, false, mk, nt, nb, v, nb, tw, nt, a2, lda, ex, true);
+    }
+
+public:
+    explicit TQRDecomposition(const TDynamicMatrix<T>& a, TExecutor& ex = matrix_executor())
+        : qr(a), tau(a.cols()), tolerance()
+    {
+        if (a.rows() < a.cols()) throw length_error("QR decomposition requires at least as many rows as columns");
+
+        const size_t m = qr.rows(), n = qr.cols(), nb = std::min(FACTOR_BLOCK, n);
+        std::unique_ptr<T[]> v(new T[m * nb]);
+        std::unique_ptr<T[]> t(new T[nb * nb]);
+        std::unique_ptr<T[]> w(new T[std::max(nb * n, m)]);
+        std::unique_ptr<T[]> tw(new T[nb * n]);
+        for (size_t k0 = 0; k0 < n; k0 += FACTOR_BLOCK)
+        {
+            const size_t k1 = std::min(n, k0 + FACTOR_BLOCK);
+            factor_panel(k0, k1, w.get());
+            if (k1 < n) update_trailing(k0, k1, v.get(), t.get(), w.get(), tw.get(), ex);
+        }
+
+        T rmax = T();
+        for (size_t i = 0; i < n; ++i) rmax = std::max<T>(rmax, std::abs(qr(i, i)));
+        tolerance = T(m) * std::numeric_limits<T>::epsilon() * rmax;
+    }
+
+    size_t rows() const noexcept { return qr.rows(); }
+
+    size_t cols() const noexcept { return qr.cols(); }
+
+    // R on and above the diagonal, the Householder vectors below it.
+    const TDynamicMatrix<T>& factors() const noexcept { return qr; }
+
+    const TDynamicVector<T>& reflector_scales() const noexcept { return tau; }
+
+    // No |R(i, i)| is within rank_tolerance() of zero.
+    bool is_full_rank() const noexcept
+    {
+        for (size_t i = 0; i < qr.cols(); ++i)
+            if (std::abs(qr(i, i)) <= tolerance) return false;
+        return true;
+    }
+
+    // m * eps * max|R(i, i)|.
+    T rank_tolerance() const noexcept { return tolerance; }
+
+    // The n x n triangular factor.
+    TDynamicMatrix<T> r() const
+    {
+        const size_t n = qr.cols();
+        TDynamicMatrix<T> res(n);
+        for (size_t i = 0; i < n; ++i)
+            std::copy(qr.row_data(i) + i, qr.row_data(i) + n, res.row_data(i) + i);
+        return res;
+    }
+
+    // The m x n matrix of the first n columns of Q, built by applying the reflectors
+    // in reverse order to those columns of the identity.
+    TDynamicMatrix<T> q() const
+    {
+        const size_t m = qr.rows(), n = qr.cols(), lda = qr.get_stride();
+        const T* a = qr.data();
+        TDynamicMatrix<T> res(m, n);
+        for (size_t i = 0; i < n; ++i) res(i, i) = T(1);
+
+        TDynamicVector<T> w(n, uninitialized);
+        for (size_t j = n; j-- > 0;)
+        {
+            if (tau[j] == T()) continue;
+            const size_t len = n - j;
+            std::copy(res.row_data(j) + j, res.row_data(j) + n, w.data());
+            for (size_t i = j + 1; i < m; ++i)
+                tsimd::axpy(len, a[i * lda + j], res.row_data(i) + j, w.data());
+            tsimd::axpy(len, -tau[j], w.data(), res.row_data(j) + j);
+            for (size_t i = j + 1; i < m; ++i)
+                tsimd::axpy(len, -tau[j] * a[i * lda + j], w.data(), res.row_data(i) + j);
+        }
+        return res;
+    }
+
+    // Q^T b, all m elements: the first n are what R x has to match, the norm of the
+    // rest is the least-squares residual.
+    TDynamicVector<T> apply_qt(const TDynamicVector<T>& b) const
+    {
+        const size_t m = qr.rows(), n = qr.cols(), lda = qr.get_stride();
+        if (b.length() != m) throw length_error("Vector and Matrix dimensions incompatible");
+
+        const T* a = qr.data();
+        TDynamicVector<T> res(b);
+        T* pb = res.data();
+        for (size_t j = 0; j < n; ++j)
+        {
+            if (tau[j] == T()) continue;
+            T s = pb[j];
+            for (size_t i = j + 1; i < m; ++i) s += a[i * lda + j] * pb[i];
+            s *= tau[j];
+            pb[j] -= s;
+            for (size_t i = j + 1; i < m; ++i) pb[i] -= s * a[i * lda + j];
+        }
+        return res;
+    }
+
+    // x minimizing ||A x - b||, by back substitution in R x = (Q^T b)(0:n). If A does
+    // not have full column rank by is_full_rank(), this throws.
+    TDynamicVector<T> solve(const TDynamicVector<T>& b) const
+    {
+        const size_t n = qr.cols();
+        const TDynamicVector<T> c = apply_qt(b);
+        if (!is_full_rank()) throw runtime_error("Matrix does not have full column rank");
+
+        TDynamicVector<T> x(n, uninitialized);
+        for (size_t i = n; i-- > 0;)
+        {
+            const T* row = qr.row_data(i);
+            x[i] = (c[i] - tsimd::dot(n - i - 1, row + i + 1, x.data() + i + 1)) / row[i];
+        }
+        return x;
+    }
+};
+
+// QR of a tall-skinny matrix by TSQR: the rows are split into blocks that are
+// factored independently on the executor, and the stacked R factors of the blocks
+// are factored once more. Only the small stacked matrix is shared, so the row
+// blocks scale with the number of threads where the panel of an ordinary QR of a
+// narrow matrix would not. R is the same as that of TQRDecomposition up to the
+// signs of its rows.
+template<typename T>
+class TTallSkinnyQR
+{
+protected:
+    size_t nRows;
+    std::vector<size_t> starts;
+    std::vector<std::unique_ptr<TQRDecomposition<T>>> blocks;
+    std::unique_ptr<TQRDecomposition<T>> top;
+
+public:
+    explicit TTallSkinnyQR(const TDynamicMatrix<T>& a, TExecutor& ex = matrix_executor())
+        : nRows(a.rows())
+    {
+        const size_t m = a.rows(), n = a.cols();
+        if (m < n) throw length_error("QR decomposition requires at least as many rows as columns");
+
+        const size_t minRows = std::max(TSQR_MIN_BLOCK_ROWS, 2 * n);
+        const size_t nBlocks = std::max<size_t>(1, std::min(ex.concurrency(), m / minRows));
+        for (size_t b = 0; b <= nBlocks; ++b) starts.push_back(b * m / nBlocks);
+        blocks.resize(nBlocks);
+
+        TSerialExecutor serial;
+        ex.parallel_for(nBlocks, [&](size_t b)
+        {
+            TDynamicMatrix<T> block(starts[b + 1] - starts[b], n, uninitialized);
+            for (size_t i = 0; i < block.rows(); ++i)
+                std::copy(a.row_data(starts[b] + i), a.row_data(starts[b] + i) + n, block.row_data(i));
+            blocks[b].reset(new TQRDecomposition<T>(block, serial));
+        });
+
+        TDynamicMatrix<T> stacked(nBlocks * n, n);
+        for (size_t b = 0; b < nBlocks; ++b)
+        {
+            const TDynamicMatrix<T>& f = blocks[b]->factors();
+            for (size_t i = 0; i < n; ++i)
+                std::copy(f.row_data(i) + i, f.row_data(i) + n, stacked.row_data(b * n + i) + i);
+        }
+        top.reset(new TQRDecomposition<T>(stacked, ex));
+    }
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return top->cols(); }
+
+    size_t block_count() const noexcept { return blocks.size(); }
+
+    bool is_full_rank() const noexcept { return top->is_full_rank(); }
+
+    TDynamicMatrix<T> r() const { return top->r(); }
+
+    // x minimizing ||A x - b||: each block applies its own Q^T to its part of b,
+    // and the leading n elements of every block are solved through the top QR.
+    TDynamicVector<T> solve(const TDynamicVector<T>& b) const
+    {
+        if (b.length() != nRows) throw length_error("Vector and Matrix dimensions incompatible");
+
+        const size_t n = cols();
+        TDynamicVector<T> stacked(blocks.size() * n, uninitialized);
+        for (size_t k = 0; k < blocks.size(); ++k)
+        {
+            TDynamicVector<T> part(starts[k + 1] - starts[k], uninitialized);
+            std::copy(b.data() + starts[k], b.data() + starts[k + 1], part.data());
+            const TDynamicVector<T> c = blocks[k]->apply_qt(part);
+            std::copy(c.data(), c.data() + n, stacked.data() + k * n);
+        }
+        return top->solve(stacked);
+    }
+};
+
+// Least-squares solution of A x = b for A with at least as many rows as columns
+// and full column rank. Matrices at least TSQR_ASPECT times taller than wide go
+// through TSQR when the executor has more than one thread.
+template<typename T>
+TDynamicVector<T> lstsq(const TDynamicMatrix<T>& a, const TDynamicVector<T>& b,
+                        TExecutor& ex = matrix_executor())
+{
+    if (b.length() != a.rows()) throw length_error("Vector and Matrix dimensions incompatible");
+    if (ex.concurrency() > 1 && a.rows() >= TSQR_ASPECT * a.cols() && a.rows() >= 2 * TSQR_MIN_BLOCK_ROWS)
+        return TTallSkinnyQR<T>(a, ex).solve(b);
+    return TQRDecomposition<T>(a, ex).solve(b);
+}
+
+#endif
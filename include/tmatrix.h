@@ -5,92 +5,357 @@
 #include <cassert>
 #include <algorithm>
 #include <stdexcept>
+#include <atomic>
+#include "tkernels.h"
+#include "texpr.h"
+#include "tmemory.h"
 
 using namespace std;
 
-const int MAX_VECTOR_LEN = 100000000;
-const int MAX_MATRIX_LEN = 10000;
+// Size caps. Build with TMATRIX_LARGE to lift them to what the address space allows,
+// or define TMATRIX_MAX_VECTOR_LEN / TMATRIX_MAX_MATRIX_LEN to choose others. Total
+// element counts are checked for overflow separately, whatever the caps.
+#ifndef TMATRIX_MAX_VECTOR_LEN
+#ifdef TMATRIX_LARGE
+#define TMATRIX_MAX_VECTOR_LEN SIZE_MAX
+#else
+#define TMATRIX_MAX_VECTOR_LEN 100000000
+#endif
+#endif
+
+#ifndef TMATRIX_MAX_MATRIX_LEN
+#ifdef TMATRIX_LARGE
+#define TMATRIX_MAX_MATRIX_LEN SIZE_MAX
+#else
+#define TMATRIX_MAX_MATRIX_LEN 10000
+#endif
+#endif
+
+const size_t MAX_VECTOR_LEN = TMATRIX_MAX_VECTOR_LEN;
+const size_t MAX_MATRIX_LEN = TMATRIX_MAX_MATRIX_LEN;
+
+// Element-wise work is split across matrix_executor() in chunks of at least this
+// many elements; smaller operations never leave the calling thread.
+const size_t PARALLEL_GRAIN = 1 << 15;
+
+// Constructor tag for results that are about to be overwritten completely: the
+// buffer is allocated with default- rather than value-initialization, so
+// arithmetic element types are not zeroed first.
+struct TUninitialized {};
+const TUninitialized uninitialized = {};
+
+// Constructor tag for an O(1) copy that shares the source's buffer until one of
+// them is written; see TDynamicMatrix.
+struct TCopyOnWrite {};
+const TCopyOnWrite copy_on_write = {};
+
+// Constructor tags for containers that wrap an existing buffer instead of copying
+// it: a borrowed buffer stays owned by the caller, an adopted one is passed to the
+// caller's deleter when the container releases it.
+struct TBorrow {};
+const TBorrow borrow = {};
+
+struct TAdopt {};
+const TAdopt adopt = {};
+
+// How square products of TDynamicMatrix are computed. MULTIPLY_STRASSEN trades a
+// little accuracy for fewer operations on matrices larger than cutoff; smaller ones
+// and rectangular products always use the classical kernel.
+enum TMultiplyAlgorithm
+{
+    MULTIPLY_CLASSICAL,
+    MULTIPLY_STRASSEN
+};
+
+struct TMultiplyPolicy
+{
+    TMultiplyAlgorithm algorithm;
+    size_t cutoff;
 
+    TMultiplyPolicy(TMultiplyAlgorithm _algorithm = MULTIPLY_CLASSICAL,
+                    size_t _cutoff = tkernels::STRASSEN_CUTOFF)
+        : algorithm(_algorithm), cutoff(_cutoff) {}
+};
+
+inline TMultiplyPolicy& active_multiply_policy() noexcept
+{
+    static TMultiplyPolicy policy;
+    return policy;
+}
+
+// Policy of operator* and of multiply() calls that do not pass their own.
+inline TMultiplyPolicy multiply_policy() noexcept { return active_multiply_policy(); }
+
+inline void set_multiply_policy(const TMultiplyPolicy& policy) noexcept
+{
+    active_multiply_policy() = policy;
+}
+
+template<typename F>
+void run_ranges(size_t n, size_t grain, const F& f)
+{
+    if (n < 2 * grain)
+        f(size_t(0), n);
+    else
+        parallel_ranges(matrix_executor(), n, grain, f);
+}
+
+template<typename T>
+class TVectorView;
+
+// Vector elements live in one 64-byte aligned buffer, allocated from pRes, unless
+// the vector was built around a borrowed or adopted one. Such a buffer is used in
+// place until the vector is resized, after which it allocates from pRes as usual.
 template<typename T>
-class TDynamicVector
+class TDynamicVector : public TVectorExpr<TDynamicVector<T>>
 {
 protected:
     size_t size;
     T* pData;
+    std::pmr::memory_resource* pRes;
+    // Owner of a borrowed or adopted buffer; null when pData came from pRes.
+    tmemory::TExternalBuffer* pExt;
 
-public:
-    TDynamicVector(size_t _size = 1) : size(_size)
+    // Returns the buffer to whoever it belongs to.
+    void free_data() noexcept
+    {
+        if (pExt != nullptr)
+            pExt->release();
+        else
+            tmemory::destroy(pRes, pData, size);
+        pData = nullptr;
+        pExt = nullptr;
+    }
+
+    static void check_size(size_t s)
     {
-        if (size == 0)
+        if (s == 0)
             throw out_of_range("Vector size must be greater than 0");
-        if (size > MAX_VECTOR_LEN)
+        if (s > MAX_VECTOR_LEN)
             throw out_of_range("Vector size is too large");
-        
-        pData = new T[size]();
     }
 
-    TDynamicVector(T* arr, size_t _size) : size(_size)
+    void check_slice(size_t begin, size_t count, size_t step) const
+    {
+        if (step == 0) throw out_of_range("Slice step must be greater than 0");
+        if (count != 0 && (begin >= size || (count - 1) > (size - 1 - begin) / step))
+            throw out_of_range("Slice exceeds vector bounds");
+    }
+
+    template<typename Op, typename E>
+    TDynamicVector& update(const E& e)
+    {
+        if (e.length() != size) throw length_error("Vector lengths mismatch");
+
+        run_ranges(size, PARALLEL_GRAIN, [&](size_t begin, size_t end)
+        {
+            expr_update<Op>(pData, e, begin, end);
+        });
+        return *this;
+    }
+
+public:
+    typedef T value_type;
+
+    TDynamicVector(size_t _size = 1, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(_size), pRes(res), pExt(nullptr)
+    {
+        check_size(size);
+        pData = tmemory::create<T>(pRes, size);
+    }
+
+    TDynamicVector(size_t _size, TUninitialized,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(_size), pRes(res), pExt(nullptr)
+    {
+        check_size(size);
+        pData = tmemory::create_uninitialized<T>(pRes, size);
+    }
+
+    TDynamicVector(const T* arr, size_t _size,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(_size), pRes(res), pExt(nullptr)
     {
         assert(arr != nullptr && "Source array cannot be null");
-        if (size == 0)
-            throw out_of_range("Vector size must be greater than 0");
-        if (size > MAX_VECTOR_LEN)
-            throw out_of_range("Vector size is too large");
+        check_size(size);
+        pData = tmemory::create_copy(pRes, arr, size);
+    }
+
+    // Works on arr in place and never frees it: the caller keeps it alive for as
+    // long as the vector uses it.
+    TDynamicVector(T* arr, size_t _size, TBorrow)
+        : size(_size), pData(arr), pRes(std::pmr::get_default_resource()), pExt(tmemory::borrowed_buffer())
+    {
+        assert(arr != nullptr && "Source array cannot be null");
+        check_size(size);
+    }
 
-        pData = new T[size];
-        std::copy(arr, arr + size, pData);
+    // Works on arr in place and calls deleter(arr) when done with it, or right away
+    // if the size is rejected.
+    template<typename D>
+    TDynamicVector(T* arr, size_t _size, TAdopt, D deleter)
+        : size(_size), pData(arr), pRes(std::pmr::get_default_resource()), pExt(nullptr)
+    {
+        assert(arr != nullptr && "Source array cannot be null");
+        try
+        {
+            check_size(size);
+        }
+        catch (...)
+        {
+            deleter(arr);
+            throw;
+        }
+        pExt = tmemory::adopt_buffer(arr, std::move(deleter));
     }
 
-    TDynamicVector(const TDynamicVector& v) : size(v.size)
+    // Like std::pmr containers, a copy allocates from the default resource unless
+    // one is given; a move takes the buffer together with its resource.
+    TDynamicVector(const TDynamicVector& v,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(v.size), pRes(res), pExt(nullptr)
     {
-        pData = new T[size];
-        std::copy(v.pData, v.pData + size, pData);
+        pData = tmemory::create_copy(pRes, v.pData, size);
     }
 
-    TDynamicVector(TDynamicVector&& v) noexcept : size(0), pData(nullptr)
+    TDynamicVector(TDynamicVector&& v) noexcept : size(0), pData(nullptr), pRes(v.pRes), pExt(nullptr)
     {
         std::swap(size, v.size);
         std::swap(pData, v.pData);
+        std::swap(pExt, v.pExt);
+    }
+
+    template<typename E>
+    TDynamicVector(const TVectorExpr<E>& e,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TDynamicVector(e.self().length(), uninitialized, res)
+    {
+        run_ranges(size, PARALLEL_GRAIN, [&](size_t begin, size_t end)
+        {
+            e.self().eval_to(pData, begin, end);
+        });
     }
 
     ~TDynamicVector()
     {
-        delete[] pData;
-        pData = nullptr;
+        free_data();
     }
 
     TDynamicVector& operator=(const TDynamicVector& v)
     {
         if (this == &v) return *this;
 
-        if (size != v.size) 
+        if (size != v.size)
         {
-            T* newData = new T[v.size];
-            delete[] pData;
+            T* newData = tmemory::create_copy(pRes, v.pData, v.size);
+            free_data();
             pData = newData;
             size = v.size;
         }
-        std::copy(v.pData, v.pData + size, pData);
-        
+        else
+            std::copy(v.pData, v.pData + size, pData);
+
         return *this;
     }
 
-    TDynamicVector& operator=(TDynamicVector&& v) noexcept
+    // The vector keeps its resource: a buffer from a different resource is copied,
+    // so a long-lived vector never ends up pointing into a short-lived arena.
+    // Borrowed and adopted buffers belong to no resource and are taken over.
+    TDynamicVector& operator=(TDynamicVector&& v)
     {
         if (this == &v) return *this;
+        if (v.pExt == nullptr && pRes != v.pRes && !(*pRes == *v.pRes)) return *this = v;
 
-        delete[] pData;
-        pData = nullptr;
+        free_data();
         size = 0;
 
         std::swap(size, v.size);
         std::swap(pData, v.pData);
+        std::swap(pExt, v.pExt);
+
+        return *this;
+    }
+
+    // The expression may read this vector: it is evaluated element by element in
+    // place, or into a fresh buffer when the length changes.
+    template<typename E>
+    TDynamicVector& operator=(const TVectorExpr<E>& e)
+    {
+        if (e.self().length() != size)
+        {
+            TDynamicVector res(e, pRes);
+            swap(*this, res);
+        }
+        else
+        {
+            run_ranges(size, PARALLEL_GRAIN, [&](size_t begin, size_t end)
+            {
+                e.self().eval_to(pData, begin, end);
+            });
+        }
+
+        return *this;
+    }
+
+    template<typename E>
+    TDynamicVector& operator+=(const TVectorExpr<E>& e)
+    {
+        return update<TAddOp>(e.self());
+    }
+
+    template<typename E>
+    TDynamicVector& operator-=(const TVectorExpr<E>& e)
+    {
+        return update<TSubOp>(e.self());
+    }
+
+    TDynamicVector& operator*=(const T& val)
+    {
+        run_ranges(size, PARALLEL_GRAIN, [&](size_t begin, size_t end)
+        {
+            tsimd::scale(end - begin, pData + begin, val, pData + begin);
+        });
+        return *this;
+    }
+
+    // this += alpha * x
+    TDynamicVector& axpy(const T& alpha, const TDynamicVector& x)
+    {
+        if (x.size != size) throw length_error("Vector lengths mismatch");
 
+        run_ranges(size, PARALLEL_GRAIN, [&](size_t begin, size_t end)
+        {
+            tsimd::axpy(end - begin, alpha, x.pData + begin, pData + begin);
+        });
         return *this;
     }
 
     size_t length() const noexcept { return size; }
 
+    std::pmr::memory_resource* get_resource() const noexcept { return pRes; }
+
+    T* data() noexcept { return pData; }
+
+    const T* data() const noexcept { return pData; }
+
+    // Elements begin, begin + step, ... (count of them), without a copy.
+    TVectorView<T> slice(size_t begin, size_t count, size_t step = 1)
+    {
+        check_slice(begin, count, step);
+        return TVectorView<T>(pData + begin, count, step);
+    }
+
+    TVectorView<const T> slice(size_t begin, size_t count, size_t step = 1) const
+    {
+        check_slice(begin, count, step);
+        return TVectorView<const T>(pData + begin, count, step);
+    }
+
+    void eval_to(T* dst, size_t begin, size_t end) const
+    {
+        if (dst != pData) std::copy(pData + begin, pData + end, dst + begin);
+    }
+
     T& operator[](size_t ind)
     {
         return pData[ind];
@@ -128,203 +393,1345 @@ public:
         return !(*this == v);
     }
 
-    TDynamicVector operator+(T val)
+    friend void swap(TDynamicVector& lhs, TDynamicVector& rhs) noexcept
     {
-        TDynamicVector res(*this);
-        for (size_t i = 0; i < size; ++i) res.pData[i] += val;
-        return res;
+        std::swap(lhs.size, rhs.size);
+        std::swap(lhs.pData, rhs.pData);
+        std::swap(lhs.pRes, rhs.pRes);
+        std::swap(lhs.pExt, rhs.pExt);
     }
 
-    TDynamicVector operator-(T val)
+    friend istream& operator>>(istream& istr, TDynamicVector& v)
     {
-        TDynamicVector res(*this);
-        for (size_t i = 0; i < size; ++i) res.pData[i] -= val;
-        return res;
+        for (size_t i = 0; i < v.size; ++i) istr >> v.pData[i];
+        return istr;
     }
 
-    TDynamicVector operator*(T val)
+    friend ostream& operator<<(ostream& ostr, const TDynamicVector& v)
     {
-        TDynamicVector res(*this);
-        for (size_t i = 0; i < size; ++i) res.pData[i] *= val;
-        return res;
+        for (size_t i = 0; i < v.size; ++i) ostr << v.pData[i] << ' ';
+        return ostr;
     }
+};
+
+template<typename T>
+struct TExprOperand<TDynamicVector<T>>
+{
+    typedef const TDynamicVector<T>& type;
+};
+
+template<typename T>
+struct TIsDenseVector<TDynamicVector<T>> : true_type {};
+
+template<typename T>
+class TMatrixRow : public TVectorExpr<TMatrixRow<T>>
+{
+public:
+    typedef typename remove_const<T>::type value_type;
+
+private:
+    T* pData;
+    size_t size;
 
-    TDynamicVector operator+(const TDynamicVector& v)
+public:
+    TMatrixRow(T* data, size_t _size) noexcept : pData(data), size(_size) {}
+
+    TMatrixRow(const TMatrixRow& r) noexcept = default;
+
+    TMatrixRow& operator=(const TMatrixRow& r)
     {
-        if (size != v.size) throw length_error("Vector lengths mismatch");
-        
-        TDynamicVector res(size);
-        for (size_t i = 0; i < size; ++i) 
-            res.pData[i] = pData[i] + v.pData[i];
-        
-        return res;
+        if (size != r.size) throw length_error("Row lengths mismatch");
+        std::copy(r.pData, r.pData + size, pData);
+        return *this;
     }
 
-    TDynamicVector operator-(const TDynamicVector& v)
+    template<typename E>
+    TMatrixRow& operator=(const TVectorExpr<E>& e)
     {
-        if (size != v.size) throw length_error("Vector lengths mismatch");
+        if (size != e.self().length()) throw length_error("Row lengths mismatch");
+        e.self().eval_to(pData, 0, size);
+        return *this;
+    }
+
+    size_t length() const noexcept { return size; }
 
-        TDynamicVector res(size);
-        for (size_t i = 0; i < size; ++i)
-            res.pData[i] = pData[i] - v.pData[i];
+    T* data() const noexcept { return pData; }
 
-        return res;
+    void eval_to(value_type* dst, size_t begin, size_t end) const
+    {
+        if (dst != pData) std::copy(pData + begin, pData + end, dst + begin);
     }
 
-    T operator*(const TDynamicVector& v)
+    T& operator[](size_t ind) const
     {
-        if (size != v.size) throw length_error("Vector lengths mismatch");
-
-        T dotProduct = T();
-        for (size_t i = 0; i < size; ++i)
-            dotProduct += pData[i] * v.pData[i];
-        
-        return dotProduct;
+        return pData[ind];
     }
 
-    friend void swap(TDynamicVector& lhs, TDynamicVector& rhs) noexcept
+    T& at(size_t ind) const
     {
-        std::swap(lhs.size, rhs.size);
-        std::swap(lhs.pData, rhs.pData);
+        if (ind >= size) throw out_of_range("Index is out of range");
+        return pData[ind];
     }
 
-    friend istream& operator>>(istream& istr, TDynamicVector& v)
+    friend istream& operator>>(istream& istr, const TMatrixRow& r)
     {
-        for (size_t i = 0; i < v.size; ++i) istr >> v.pData[i];
+        for (size_t i = 0; i < r.size; ++i) istr >> r.pData[i];
         return istr;
     }
 
-    friend ostream& operator<<(ostream& ostr, const TDynamicVector& v)
+    friend ostream& operator<<(ostream& ostr, const TMatrixRow& r)
     {
-        for (size_t i = 0; i < v.size; ++i) ostr << v.pData[i] << ' ';
+        for (size_t i = 0; i < r.size; ++i) ostr << r.pData[i] << ' ';
         return ostr;
     }
 };
 
 template<typename T>
-class TDynamicMatrix : private TDynamicVector<TDynamicVector<T>>
-{
-    using Base = TDynamicVector<TDynamicVector<T>>;
-    using Base::pData;
-    using Base::size;
+struct TIsDenseVector<TMatrixRow<T>> : true_type {};
+
+template<typename T>
+class TDynamicMatrix;
 
+template<typename T>
+class TTransposedView;
+
+template<typename A, typename B>
+TDynamicMatrix<typename A::value_type> dense_product(const A& a, const B& b, const TMultiplyPolicy& policy,
+                                                     TExecutor& ex, std::pmr::memory_resource* res);
+
+// A strided window on existing elements: element i is pData[i * inc], so a matrix
+// column or diagonal is a view with no copy. Views do not own their elements and
+// are invalidated when the storage they point into is reallocated or destroyed.
+// TVectorView<const T> is the read-only view.
+template<typename T>
+class TVectorView : public TVectorExpr<TVectorView<T>>
+{
 public:
-    TDynamicMatrix(size_t s = 1) : Base(s)
+    typedef typename remove_const<T>::type value_type;
+
+private:
+    T* pData;
+    size_t size;
+    size_t inc;
+
+    template<typename Op, typename E>
+    TVectorView& update(const E& e)
     {
-        if (s == 0)
-            throw out_of_range("Matrix size must be greater than 0");
-        if (s > MAX_MATRIX_LEN)
-            throw out_of_range("Matrix size exceeds maximum limit");
-        
-        for (size_t i = 0; i < size; ++i)
-            pData[i] = TDynamicVector<T>(size);
+        if (e.length() != size) throw length_error("Vector lengths mismatch");
+        for (size_t i = 0; i < size; ++i) pData[i * inc] = Op::apply(pData[i * inc], e[i]);
+        return *this;
     }
 
-    TDynamicVector<T>& operator[](size_t ind)
+public:
+    TVectorView(T* data, size_t _size, size_t _inc = 1) noexcept : pData(data), size(_size), inc(_inc) {}
+
+    TVectorView(const TVectorView& v) noexcept = default;
+
+    template<typename U>
+    TVectorView(const TVectorView<U>& v) noexcept : pData(v.data()), size(v.length()), inc(v.stride()) {}
+
+    TVectorView& operator=(const TVectorView& v)
     {
-        if (ind >= size) throw out_of_range("Matrix index out of range");
-        return pData[ind];
+        return *this = static_cast<const TVectorExpr<TVectorView>&>(v);
     }
 
-    const TDynamicVector<T>& operator[](size_t ind) const
+    // Element i of the expression may read element i of this view, but no other.
+    template<typename E>
+    TVectorView& operator=(const TVectorExpr<E>& e)
     {
-        if (ind >= size) throw out_of_range("Matrix index out of range");
-        return pData[ind];
+        if (size != e.self().length()) throw length_error("Vector lengths mismatch");
+        if (inc == 1)
+            e.self().eval_to(pData, 0, size);
+        else
+            for (size_t i = 0; i < size; ++i) pData[i * inc] = e.self()[i];
+        return *this;
     }
 
-    size_t get_size() const { return size; } 
+    template<typename E>
+    TVectorView& operator+=(const TVectorExpr<E>& e)
+    {
+        return update<TAddOp>(e.self());
+    }
 
-    bool operator==(const TDynamicMatrix& m) const noexcept
+    template<typename E>
+    TVectorView& operator-=(const TVectorExpr<E>& e)
     {
-        return Base::operator==(m);
+        return update<TSubOp>(e.self());
     }
 
-    bool operator!=(const TDynamicMatrix& m) const noexcept
+    TVectorView& operator*=(const value_type& val)
     {
-        return !(*this == m);
+        for (size_t i = 0; i < size; ++i) pData[i * inc] *= val;
+        return *this;
     }
 
-    TDynamicMatrix<T> operator*(const T& val)
+    size_t length() const noexcept { return size; }
+
+    // Distance between consecutive elements, in elements.
+    size_t stride() const noexcept { return inc; }
+
+    T* data() const noexcept { return pData; }
+
+    void eval_to(value_type* dst, size_t begin, size_t end) const
     {
-        TDynamicMatrix<T> res(size);
-        for (size_t i = 0; i < size; ++i)
+        if (inc == 1)
         {
-            res[i] = pData[i] * val;
+            if (dst != pData) std::copy(pData + begin, pData + end, dst + begin);
         }
-        return res;
+        else
+            for (size_t i = begin; i < end; ++i) dst[i] = pData[i * inc];
     }
 
-    TDynamicVector<T> operator*(const TDynamicVector<T>& v)
+    T& operator[](size_t ind) const
     {
-        if (v.length() != size)
-            throw length_error("Vector and Matrix dimensions incompatible");
+        return pData[ind * inc];
+    }
 
-        TDynamicVector<T> res(size);
-        for (size_t i = 0; i < size; ++i)
-        {
-            res[i] = pData[i] * v;
-        }
-        return res;
+    T& at(size_t ind) const
+    {
+        if (ind >= size) throw out_of_range("Index is out of range");
+        return pData[ind * inc];
     }
 
-    TDynamicMatrix operator+(const TDynamicMatrix& m)
+    friend ostream& operator<<(ostream& ostr, const TVectorView& v)
     {
-        if (m.get_size() != size)
-            throw length_error("Matrix dimensions mismatch");
+        for (size_t i = 0; i < v.size; ++i) ostr << v[i] << ' ';
+        return ostr;
+    }
+};
+
+// A rows x cols block of a row-major matrix with the given row stride, e.g. a panel
+// or a trailing submatrix. Every row is contiguous, so views go through the same
+// vectorized row kernels, GEMM and GEMV as TDynamicMatrix without being copied.
+// Like TVectorView it does not own its elements; TMatrixView<const T> is read-only.
+template<typename T>
+class TMatrixView : public TMatrixExpr<TMatrixView<T>>
+{
+public:
+    typedef typename remove_const<T>::type value_type;
+
+private:
+    T* pData;
+    size_t nRows;
+    size_t nCols;
+    size_t stride;
+
+    static void check_block(size_t r, size_t c, size_t rows, size_t cols, size_t nr, size_t nc)
+    {
+        if (r > nr || rows > nr - r || c > nc || cols > nc - c)
+            throw out_of_range("Submatrix exceeds matrix bounds");
+    }
+
+    template<typename F>
+    void for_each_row_range(const F& f) const
+    {
+        if (nCols != 0) run_ranges(nRows, std::max<size_t>(1, PARALLEL_GRAIN / nCols), f);
+    }
 
-        TDynamicMatrix<T> res(size);
-        for (size_t i = 0; i < size; ++i)
+    template<typename Op, typename E>
+    TMatrixView& update(const E& e)
+    {
+        if (e.rows() != nRows || e.cols() != nCols) throw length_error("Matrix dimensions mismatch");
+        if (expr_reads_across_rows(e, pData, nRows, stride))
+            return update<Op>(TDynamicMatrix<value_type>(e));
+
+        for_each_row_range([&](size_t begin, size_t end)
         {
-            res[i] = pData[i] + m[i];
-        }
-        return res;
+            for (size_t i = begin; i < end; ++i)
+                expr_update_row<Op>(row_data(i), e, i);
+        });
+        return *this;
+    }
+
+public:
+    TMatrixView(T* data, size_t rows, size_t cols, size_t _stride) noexcept
+        : pData(data), nRows(rows), nCols(cols), stride(_stride) {}
+
+    TMatrixView(const TMatrixView& m) noexcept = default;
+
+    template<typename U>
+    TMatrixView(const TMatrixView<U>& m) noexcept
+        : pData(m.data()), nRows(m.rows()), nCols(m.cols()), stride(m.get_stride()) {}
+
+    TMatrixView& operator=(const TMatrixView& m)
+    {
+        return *this = static_cast<const TMatrixExpr<TMatrixView>&>(m);
     }
 
-    TDynamicMatrix operator-(const TDynamicMatrix& m)
+    // Row i of the expression may read row i of this view; one that reads other rows
+    // of it, such as v = v.t() or an overlapping submatrix, is evaluated into a
+    // temporary matrix first, as TDynamicMatrix does.
+    template<typename E>
+    TMatrixView& operator=(const TMatrixExpr<E>& e)
     {
-        if (m.get_size() != size)
+        if (e.self().rows() != nRows || e.self().cols() != nCols)
             throw length_error("Matrix dimensions mismatch");
+        if (expr_reads_across_rows(e.self(), pData, nRows, stride))
+            return *this = TDynamicMatrix<value_type>(e.self());
 
-        TDynamicMatrix<T> res(size);
-        for (size_t i = 0; i < size; ++i)
+        for_each_row_range([&](size_t begin, size_t end)
         {
-            res[i] = pData[i] - m[i];
-        }
-        return res;
+            for (size_t i = begin; i < end; ++i)
+                e.self().eval_row(i, row_data(i));
+        });
+        return *this;
     }
 
-    TDynamicMatrix operator*(const TDynamicMatrix& m)
+    template<typename E>
+    TMatrixView& operator+=(const TMatrixExpr<E>& e)
     {
-        if (m.get_size() != size)
-            throw length_error("Matrix dimensions mismatch for multiplication");
+        return update<TAddOp>(e.self());
+    }
 
-        TDynamicMatrix<T> res(size);
-        for (size_t i = 0; i < size; ++i) 
+    template<typename E>
+    TMatrixView& operator-=(const TMatrixExpr<E>& e)
+    {
+        return update<TSubOp>(e.self());
+    }
+
+    TMatrixView& operator*=(const value_type& val)
+    {
+        for_each_row_range([&](size_t begin, size_t end)
         {
-            for (size_t j = 0; j < size; ++j) 
-            {
-                T sum = T();
-                for (size_t k = 0; k < size; ++k) 
-                {
-                    sum += pData[i][k] * m[k][j];
-                }
-                res[i][j] = sum;
-            }
-        }
-        return res;
+            for (size_t i = begin; i < end; ++i)
+                tsimd::scale(nCols, row_data(i), val, row_data(i));
+        });
+        return *this;
     }
 
-    friend istream& operator>>(istream& istr, TDynamicMatrix& m)
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    bool is_square() const noexcept { return nRows == nCols; }
+
+    size_t get_stride() const noexcept { return stride; }
+
+    T* data() const noexcept { return pData; }
+
+    T* row_data(size_t i) const noexcept { return pData + i * stride; }
+
+    T& operator()(size_t i, size_t j) const noexcept { return pData[i * stride + j]; }
+
+    TMatrixRow<T> operator[](size_t ind) const
     {
-        for (size_t i = 0; i < m.size; ++i) istr >> m.pData[i];
-        return istr;
+        if (ind >= nRows) throw out_of_range("Matrix index out of range");
+        return TMatrixRow<T>(row_data(ind), nCols);
     }
 
-    friend ostream& operator<<(ostream& ostr, const TDynamicMatrix& m)
+    void eval_row(size_t i, value_type* dst) const
     {
-        for (size_t i = 0; i < m.size; ++i) ostr << m.pData[i] << endl;
-        return ostr;
+        if (dst != row_data(i)) std::copy(row_data(i), row_data(i) + nCols, dst);
     }
-};
+
+    TMatrixView submatrix(size_t r, size_t c, size_t rows, size_t cols) const
+    {
+        check_block(r, c, rows, cols, nRows, nCols);
+        return TMatrixView(row_data(r) + c, rows, cols, stride);
+    }
+
+    TMatrixRow<T> row(size_t i) const
+    {
+        return (*this)[i];
+    }
+
+    TVectorView<T> col(size_t j) const
+    {
+        if (j >= nCols) throw out_of_range("Matrix index out of range");
+        return TVectorView<T>(pData + j, nRows, stride);
+    }
+
+    TVectorView<T> diagonal() const noexcept
+    {
+        return TVectorView<T>(pData, std::min(nRows, nCols), stride + 1);
+    }
+
+    TTransposedView<value_type> t() const noexcept
+    {
+        return TTransposedView<value_type>(pData, nCols, nRows, stride);
+    }
+
+    template<typename M>
+    TDynamicMatrix<value_type> multiply(const M& m, const TMultiplyPolicy& policy, TExecutor& ex) const
+    {
+        return dense_product(*this, m, policy, ex, std::pmr::get_default_resource());
+    }
+
+    template<typename M>
+    TDynamicMatrix<value_type> multiply(const M& m, TExecutor& ex) const
+    {
+        return multiply(m, multiply_policy(), ex);
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TMatrixView& m)
+    {
+        for (size_t i = 0; i < m.nRows; ++i) ostr << m[i] << endl;
+        return ostr;
+    }
+};
+
+template<typename T>
+struct TIsDenseMatrix<TMatrixView<T>> : true_type {};
+
+// The transpose of a row-major matrix, read in place: element (i, j) is element
+// (j, i) of the source, whose rows are source_stride() apart. Products pass it to
+// GEMM and GEMV as a transposed operand, and a TDynamicMatrix built from it runs the
+// blocked transpose kernel; other expressions read it element by element. Assigned
+// to its own source, m = m.t() is done in place and an expression such as
+// m = a + m.t() is evaluated into a fresh buffer (see expr_reads_across_rows).
+template<typename T>
+class TTransposedView : public TMatrixExpr<TTransposedView<T>>
+{
+public:
+    typedef T value_type;
+
+private:
+    const T* pData;
+    size_t nRows;
+    size_t nCols;
+    size_t stride;
+
+public:
+    TTransposedView(const T* data, size_t rows, size_t cols, size_t _stride) noexcept
+        : pData(data), nRows(rows), nCols(cols), stride(_stride) {}
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    bool is_square() const noexcept { return nRows == nCols; }
+
+    size_t source_stride() const noexcept { return stride; }
+
+    const T* data() const noexcept { return pData; }
+
+    const T& operator()(size_t i, size_t j) const noexcept { return pData[j * stride + i]; }
+
+    void eval_row(size_t i, T* dst) const
+    {
+        for (size_t j = 0; j < nCols; ++j) dst[j] = pData[j * stride + i];
+    }
+
+    // The source matrix.
+    TMatrixView<const T> t() const noexcept
+    {
+        return TMatrixView<const T>(pData, nCols, nRows, stride);
+    }
+
+    template<typename M>
+    TDynamicMatrix<T> multiply(const M& m, const TMultiplyPolicy& policy, TExecutor& ex) const
+    {
+        return dense_product(*this, m, policy, ex, std::pmr::get_default_resource());
+    }
+
+    template<typename M>
+    TDynamicMatrix<T> multiply(const M& m, TExecutor& ex) const
+    {
+        return multiply(m, multiply_policy(), ex);
+    }
+};
+
+// Set for matrices that products read as the transpose of a row-major buffer.
+template<typename E>
+struct TIsTransposedMatrix : false_type {};
+
+template<typename T>
+struct TIsTransposedMatrix<TTransposedView<T>> : true_type {};
+
+// Distance between the stored rows of a product operand.
+template<typename M>
+size_t leading_dimension(const M& m) noexcept
+{
+    return m.get_stride();
+}
+
+template<typename T>
+size_t leading_dimension(const TTransposedView<T>& m) noexcept
+{
+    return m.source_stride();
+}
+
+// Whether the rows x cols block at a with row stride lda shares memory with the
+// rows x stride buffer at data.
+template<typename T>
+bool block_overlaps(const T* a, size_t rows, size_t cols, size_t lda, const T* data, size_t n, size_t stride) noexcept
+{
+    if (rows == 0 || cols == 0 || n == 0) return false;
+    const std::less<const T*> less;
+    return less(a, data + n * stride) && less(data, a + (rows - 1) * lda + cols);
+}
+
+// Row i of a transpose reads column i of its source, i.e. every row of it.
+template<typename T>
+bool expr_reads_across_rows(const TTransposedView<T>& e, const T* data, size_t rows, size_t stride) noexcept
+{
+    return block_overlaps(e.data(), e.cols(), e.rows(), e.source_stride(), data, rows, stride);
+}
+
+// A view reads row i for row i only when it starts at data with the same stride.
+template<typename U, typename T>
+bool expr_reads_across_rows(const TMatrixView<U>& e, const T* data, size_t rows, size_t stride) noexcept
+{
+    const T* p = e.data();
+    return (p != data || e.get_stride() != stride) &&
+           block_overlaps(p, e.rows(), e.cols(), e.get_stride(), data, rows, stride);
+}
+
+
+// A rows x cols matrix. Elements live in one 64-byte aligned row-major buffer; row i
+// starts at pData + i * stride, where stride pads the row to a whole number of cache
+// lines. Every row is therefore aligned, and threads writing adjacent rows never
+// share a cache line. The padding elements are zero and not part of the matrix.
+//
+// Copies are deep, except those made with the copy_on_write tag: they share the
+// buffer, and its memory resource, under a reference count until a matrix is
+// written through operator[], operator(), data(), row_data() or any modifying
+// operation, which first gives that matrix a private copy. The count is atomic, so
+// matrices sharing a buffer may be read, copied, written and destroyed by different
+// threads independently; a single matrix still must not be written by one thread
+// while another uses it. Rows, references and pointers obtained for writing before
+// a copy-on-write copy is made keep pointing into the shared buffer.
+//
+// A matrix can also be built around a borrowed or adopted row-major buffer with the
+// caller's row stride, which is used in place (its padding, if any, is left as it
+// is) until the matrix is reshaped or detached from copy-on-write sharers.
+template<typename T>
+class TDynamicMatrix : public TMatrixExpr<TDynamicMatrix<T>>
+{
+protected:
+    size_t nRows;
+    size_t nCols;
+    size_t stride;
+    T* pData;
+    std::pmr::memory_resource* pRes;
+    // Owner of a borrowed or adopted buffer; null when pData came from pRes.
+    tmemory::TExternalBuffer* pExt;
+    // Owners of a buffer shared by copy-on-write copies; null until the first one.
+    mutable std::atomic<std::atomic<size_t>*> pRefs;
+
+    std::atomic<size_t>* share_count() const
+    {
+        std::atomic<size_t>* refs = pRefs.load(std::memory_order_acquire);
+        if (refs != nullptr) return refs;
+
+        std::atomic<size_t>* fresh = new std::atomic<size_t>(1);
+        if (pRefs.compare_exchange_strong(refs, fresh, std::memory_order_acq_rel))
+            return fresh;
+        delete fresh;
+        return refs;
+    }
+
+    // Drops this matrix's ownership of the buffer, destroying it with the last owner.
+    void release() noexcept
+    {
+        std::atomic<size_t>* refs = pRefs.load(std::memory_order_relaxed);
+        if (refs == nullptr || refs->fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            if (pExt != nullptr)
+                pExt->release();
+            else
+                tmemory::destroy(pRes, pData, nRows * stride);
+            delete refs;
+        }
+        pData = nullptr;
+        pExt = nullptr;
+        pRefs.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // Gives this matrix a private copy of a shared buffer before it is written.
+    void detach()
+    {
+        if (!is_shared()) return;
+
+        T* newData = tmemory::create_copy(pRes, pData, nRows * stride);
+        release();
+        pData = newData;
+    }
+
+    static void check_size(size_t rows, size_t cols)
+    {
+        if (rows == 0 || cols == 0)
+            throw out_of_range("Matrix size must be greater than 0");
+        if (rows > MAX_MATRIX_LEN || cols > MAX_MATRIX_LEN)
+            throw out_of_range("Matrix size exceeds maximum limit");
+    }
+
+    static void check_wrapped(size_t rows, size_t cols, size_t _stride)
+    {
+        check_size(rows, cols);
+        if (_stride < cols)
+            throw out_of_range("Row stride is less than the number of columns");
+        tmemory::checked_mul(rows, _stride);
+    }
+
+    template<typename F>
+    void for_each_row_range(const F& f) const
+    {
+        run_ranges(nRows, std::max<size_t>(1, PARALLEL_GRAIN / nCols), f);
+    }
+
+    // The buffer must not be shared: rows are written through pData directly.
+    template<typename E>
+    void assign(const E& e)
+    {
+        for_each_row_range([&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                e.eval_row(i, pData + i * stride);
+        });
+    }
+
+    template<typename Op, typename E>
+    TDynamicMatrix& update(const E& e)
+    {
+        if (e.rows() != nRows || e.cols() != nCols) throw length_error("Matrix dimensions mismatch");
+        if (expr_reads_across_rows(e, pData, nRows, stride))
+            return update<Op>(TDynamicMatrix(e, pRes));
+
+        detach();
+        for_each_row_range([&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                expr_update_row<Op>(pData + i * stride, e, i);
+        });
+        return *this;
+    }
+
+public:
+    typedef T value_type;
+
+    TDynamicMatrix(size_t s = 1) : TDynamicMatrix(s, s) {}
+
+    // An s x s matrix in res. R is deduced from a pointer to any memory_resource, so
+    // a literal 0 second argument, which does not deduce, selects rows x cols
+    // instead of being ambiguous with a null resource.
+    template<typename R, typename = typename std::enable_if<
+                             std::is_convertible<R*, std::pmr::memory_resource*>::value>::type>
+    TDynamicMatrix(size_t s, R* res) : TDynamicMatrix(s, s, res) {}
+
+    TDynamicMatrix(size_t rows, size_t cols,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(rows), nCols(cols), stride(tmemory::padded_length<T>(cols)), pRes(res), pExt(nullptr),
+          pRefs(nullptr)
+    {
+        check_size(rows, cols);
+        pData = tmemory::create<T>(pRes, tmemory::checked_mul(nRows, stride));
+    }
+
+    TDynamicMatrix(size_t s, TUninitialized,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TDynamicMatrix(s, s, uninitialized, res) {}
+
+    TDynamicMatrix(size_t rows, size_t cols, TUninitialized,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(rows), nCols(cols), stride(tmemory::padded_length<T>(cols)), pRes(res), pExt(nullptr),
+          pRefs(nullptr)
+    {
+        check_size(rows, cols);
+        pData = tmemory::create_uninitialized<T>(pRes, tmemory::checked_mul(nRows, stride));
+        for (size_t i = 0; i < nRows; ++i)
+            std::fill(pData + i * stride + nCols, pData + (i + 1) * stride, T());
+    }
+
+    // Works in place on the rows x cols matrix whose row i starts at data + i * _stride
+    // and never frees it: the caller keeps the rows * _stride elements alive for as
+    // long as the matrix uses them.
+    TDynamicMatrix(T* data, size_t rows, size_t cols, size_t _stride, TBorrow)
+        : nRows(rows), nCols(cols), stride(_stride), pData(data), pRes(std::pmr::get_default_resource()),
+          pExt(tmemory::borrowed_buffer()), pRefs(nullptr)
+    {
+        assert(data != nullptr && "Source array cannot be null");
+        check_wrapped(rows, cols, _stride);
+    }
+
+    // As above, but calls deleter(data) when done with the buffer, or right away if
+    // the shape is rejected.
+    template<typename D>
+    TDynamicMatrix(T* data, size_t rows, size_t cols, size_t _stride, TAdopt, D deleter)
+        : nRows(rows), nCols(cols), stride(_stride), pData(data), pRes(std::pmr::get_default_resource()),
+          pExt(nullptr), pRefs(nullptr)
+    {
+        assert(data != nullptr && "Source array cannot be null");
+        try
+        {
+            check_wrapped(rows, cols, _stride);
+        }
+        catch (...)
+        {
+            deleter(data);
+            throw;
+        }
+        pExt = tmemory::adopt_buffer(data, std::move(deleter));
+    }
+
+    // Copies and moves follow the same resource rules as TDynamicVector.
+    TDynamicMatrix(const TDynamicMatrix& m,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.nRows), nCols(m.nCols), stride(m.stride), pRes(res), pExt(nullptr), pRefs(nullptr)
+    {
+        pData = tmemory::create_copy(pRes, m.pData, nRows * stride);
+    }
+
+    TDynamicMatrix(const TDynamicMatrix& m, TCopyOnWrite)
+        : nRows(m.nRows), nCols(m.nCols), stride(m.stride), pData(m.pData), pRes(m.pRes),
+          pExt(m.pExt), pRefs(m.share_count())
+    {
+        pRefs.load(std::memory_order_relaxed)->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    TDynamicMatrix(TDynamicMatrix&& m) noexcept
+        : nRows(0), nCols(0), stride(0), pData(nullptr), pRes(m.pRes), pExt(nullptr), pRefs(nullptr)
+    {
+        swap(*this, m);
+    }
+
+    template<typename E>
+    TDynamicMatrix(const TMatrixExpr<E>& e,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TDynamicMatrix(e.self().rows(), e.self().cols(), uninitialized, res)
+    {
+        assign(e.self());
+    }
+
+    // Runs the blocked transpose kernel instead of gathering one column per row.
+    TDynamicMatrix(const TTransposedView<T>& e,
+                   std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TDynamicMatrix(e.rows(), e.cols(), uninitialized, res)
+    {
+        tkernels::transpose(nCols, nRows, e.data(), e.source_stride(), pData, stride, matrix_executor());
+    }
+
+    ~TDynamicMatrix()
+    {
+        release();
+    }
+
+    TDynamicMatrix& operator=(const TDynamicMatrix& m)
+    {
+        if (this == &m) return *this;
+
+        // A wrapped buffer keeps its layout, so the caller sees the new elements.
+        if (pExt != nullptr && nRows == m.nRows && nCols == m.nCols && !is_shared())
+        {
+            for (size_t i = 0; i < nRows; ++i)
+                std::copy(m.row_data(i), m.row_data(i) + nCols, pData + i * stride);
+            return *this;
+        }
+
+        if (nRows * stride != m.nRows * m.stride || is_shared() || pExt != nullptr)
+        {
+            T* newData = tmemory::create_copy(pRes, m.pData, m.nRows * m.stride);
+            release();
+            pData = newData;
+        }
+        else
+            std::copy(m.pData, m.pData + m.nRows * m.stride, pData);
+        nRows = m.nRows;
+        nCols = m.nCols;
+        stride = m.stride;
+
+        return *this;
+    }
+
+    TDynamicMatrix& operator=(TDynamicMatrix&& m)
+    {
+        if (this == &m) return *this;
+        if (m.pExt == nullptr && pRes != m.pRes && !(*pRes == *m.pRes)) return *this = m;
+
+        release();
+        nRows = nCols = stride = 0;
+        swap(*this, m);
+
+        return *this;
+    }
+
+    // Row i of the result only depends on row i of the operands, so the expression
+    // may read this matrix; one that reads other rows of it, through a transpose or
+    // a shifted view, is evaluated into a fresh buffer instead. A shared buffer is
+    // left to the other owners rather than copied, since every element is overwritten.
+    template<typename E>
+    TDynamicMatrix& operator=(const TMatrixExpr<E>& e)
+    {
+        if (e.self().rows() != nRows || e.self().cols() != nCols || is_shared() ||
+            expr_reads_across_rows(e.self(), pData, nRows, stride))
+        {
+            TDynamicMatrix res(e, pRes);
+            swap(*this, res);
+        }
+        else
+            assign(e.self());
+
+        return *this;
+    }
+
+    // Row i of a transpose is a column of its source, so m = m.t() is done in place
+    // and a transpose of any other part of this buffer goes through a fresh one.
+    TDynamicMatrix& operator=(const TTransposedView<T>& e)
+    {
+        if (e.data() == pData && e.source_stride() == stride && e.rows() == nCols && e.cols() == nRows)
+        {
+            transpose_inplace();
+            return *this;
+        }
+
+        if (e.rows() != nRows || e.cols() != nCols || is_shared() ||
+            expr_reads_across_rows(e, pData, nRows, stride))
+        {
+            TDynamicMatrix res(e, pRes);
+            swap(*this, res);
+        }
+        else
+            tkernels::transpose(nCols, nRows, e.data(), e.source_stride(), pData, stride, matrix_executor());
+
+        return *this;
+    }
+
+    template<typename E>
+    TDynamicMatrix& operator+=(const TMatrixExpr<E>& e)
+    {
+        return update<TAddOp>(e.self());
+    }
+
+    template<typename E>
+    TDynamicMatrix& operator-=(const TMatrixExpr<E>& e)
+    {
+        return update<TSubOp>(e.self());
+    }
+
+    TDynamicMatrix& operator*=(const T& val)
+    {
+        detach();
+        for_each_row_range([&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                tsimd::scale(nCols, pData + i * stride, val, pData + i * stride);
+        });
+        return *this;
+    }
+
+    // this += alpha * x
+    TDynamicMatrix& axpy(const T& alpha, const TDynamicMatrix& x)
+    {
+        if (x.nRows != nRows || x.nCols != nCols) throw length_error("Matrix dimensions mismatch");
+
+        detach();
+        for_each_row_range([&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                tsimd::axpy(nCols, alpha, x.row_data(i), pData + i * stride);
+        });
+        return *this;
+    }
+
+    TMatrixRow<T> operator[](size_t ind)
+    {
+        if (ind >= nRows) throw out_of_range("Matrix index out of range");
+        detach();
+        return TMatrixRow<T>(pData + ind * stride, nCols);
+    }
+
+    TMatrixRow<const T> operator[](size_t ind) const
+    {
+        if (ind >= nRows) throw out_of_range("Matrix index out of range");
+        return TMatrixRow<const T>(pData + ind * stride, nCols);
+    }
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    bool is_square() const noexcept { return nRows == nCols; }
+
+    // Number of rows, kept for code written against square matrices.
+    size_t get_size() const { return nRows; }
+
+    size_t get_stride() const noexcept { return stride; }
+
+    std::pmr::memory_resource* get_resource() const noexcept { return pRes; }
+
+    // Whether the buffer is currently shared with a copy_on_write copy.
+    bool is_shared() const noexcept
+    {
+        const std::atomic<size_t>* refs = pRefs.load(std::memory_order_acquire);
+        return refs != nullptr && refs->load(std::memory_order_acquire) > 1;
+    }
+
+    T* data()
+    {
+        detach();
+        return pData;
+    }
+
+    const T* data() const noexcept { return pData; }
+
+    T* row_data(size_t i)
+    {
+        detach();
+        return pData + i * stride;
+    }
+
+    const T* row_data(size_t i) const noexcept { return pData + i * stride; }
+
+    T& operator()(size_t i, size_t j)
+    {
+        detach();
+        return pData[i * stride + j];
+    }
+
+    const T& operator()(size_t i, size_t j) const noexcept { return pData[i * stride + j]; }
+
+    void eval_row(size_t i, T* dst) const
+    {
+        if (dst != row_data(i)) std::copy(row_data(i), row_data(i) + nCols, dst);
+    }
+
+    bool operator==(const TDynamicMatrix& m) const noexcept
+    {
+        if (nRows != m.nRows || nCols != m.nCols) return false;
+        for (size_t i = 0; i < nRows; ++i)
+        {
+            const T* a = pData + i * stride;
+            const T* b = m.pData + i * m.stride;
+            for (size_t j = 0; j < nCols; ++j)
+                if (a[j] != b[j]) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const TDynamicMatrix& m) const noexcept
+    {
+        return !(*this == m);
+    }
+
+    // (rows x cols) * (cols x m.cols), where m is a TDynamicMatrix or a TMatrixView.
+    template<typename M>
+    TDynamicMatrix multiply(const M& m, const TMultiplyPolicy& policy, TExecutor& ex) const
+    {
+        return dense_product(*this, m, policy, ex, pRes);
+    }
+
+    template<typename M>
+    TDynamicMatrix multiply(const M& m, TExecutor& ex) const
+    {
+        return multiply(m, multiply_policy(), ex);
+    }
+
+    // res = A * x into a vector of rows() elements, without allocating.
+    void multiply(const TDynamicVector<T>& x, TDynamicVector<T>& res) const
+    {
+        if (x.length() != nCols || res.length() != nRows)
+            throw length_error("Vector and Matrix dimensions incompatible");
+        tkernels::gemv(nRows, nCols, pData, stride, x.data(), res.data(), matrix_executor());
+    }
+
+    TMatrixView<T> view()
+    {
+        detach();
+        return TMatrixView<T>(pData, nRows, nCols, stride);
+    }
+
+    TMatrixView<const T> view() const noexcept
+    {
+        return TMatrixView<const T>(pData, nRows, nCols, stride);
+    }
+
+    // Rows r..r+rows-1, columns c..c+cols-1, without a copy.
+    TMatrixView<T> submatrix(size_t r, size_t c, size_t rows, size_t cols)
+    {
+        return view().submatrix(r, c, rows, cols);
+    }
+
+    TMatrixView<const T> submatrix(size_t r, size_t c, size_t rows, size_t cols) const
+    {
+        return view().submatrix(r, c, rows, cols);
+    }
+
+    TMatrixRow<T> row(size_t i)
+    {
+        return (*this)[i];
+    }
+
+    TMatrixRow<const T> row(size_t i) const
+    {
+        return (*this)[i];
+    }
+
+    TVectorView<T> col(size_t j)
+    {
+        return view().col(j);
+    }
+
+    TVectorView<const T> col(size_t j) const
+    {
+        return view().col(j);
+    }
+
+    TVectorView<T> diagonal()
+    {
+        return view().diagonal();
+    }
+
+    TVectorView<const T> diagonal() const noexcept
+    {
+        return view().diagonal();
+    }
+
+    // The transpose as a lazy view, the counterpart of .T in NumPy: A * B.t() hands
+    // B to GEMM as a transposed operand and never forms B^T.
+    TTransposedView<T> t() const noexcept
+    {
+        return TTransposedView<T>(pData, nCols, nRows, stride);
+    }
+
+    // A new cols x rows matrix holding the transpose.
+    TDynamicMatrix transpose() const
+    {
+        return TDynamicMatrix(t());
+    }
+
+    // A square matrix swaps mirrored blocks within its buffer. Other shapes need a
+    // different row stride and are transposed into a new buffer.
+    void transpose_inplace()
+    {
+        if (is_square())
+        {
+            detach();
+            tkernels::transpose_inplace(nRows, pData, stride, matrix_executor());
+        }
+        else
+        {
+            TDynamicMatrix res(t(), pRes);
+            swap(*this, res);
+        }
+    }
+
+    friend void swap(TDynamicMatrix& lhs, TDynamicMatrix& rhs) noexcept
+    {
+        std::swap(lhs.nRows, rhs.nRows);
+        std::swap(lhs.nCols, rhs.nCols);
+        std::swap(lhs.stride, rhs.stride);
+        std::swap(lhs.pData, rhs.pData);
+        std::swap(lhs.pRes, rhs.pRes);
+        std::swap(lhs.pExt, rhs.pExt);
+        lhs.pRefs.store(rhs.pRefs.exchange(lhs.pRefs.load(std::memory_order_relaxed),
+                                           std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    friend istream& operator>>(istream& istr, TDynamicMatrix& m)
+    {
+        for (size_t i = 0; i < m.nRows; ++i) istr >> m[i];
+        return istr;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TDynamicMatrix& m)
+    {
+        for (size_t i = 0; i < m.nRows; ++i) ostr << m[i] << endl;
+        return ostr;
+    }
+};
+
+template<typename T>
+struct TExprOperand<TDynamicMatrix<T>>
+{
+    typedef const TDynamicMatrix<T>& type;
+};
+
+template<typename T>
+struct TIsDenseMatrix<TDynamicMatrix<T>> : true_type {};
+
+// a * b for matrices stored row-major with a fixed stride, i.e. TDynamicMatrix and
+// TMatrixView, or transposes of them, all read in place. The result, the Strassen
+// workspace and any transposed operand formed for Strassen are allocated from res.
+template<typename A, typename B>
+TDynamicMatrix<typename A::value_type> dense_product(const A& a, const B& b, const TMultiplyPolicy& policy,
+                                                     TExecutor& ex, std::pmr::memory_resource* res)
+{
+    typedef typename A::value_type T;
+    static_assert(std::is_same<T, typename B::value_type>::value,
+                  "Operands must have the same element type");
+    if (b.rows() != a.cols())
+        throw length_error("Matrix dimensions mismatch for multiplication");
+
+    const bool ta = TIsTransposedMatrix<A>::value, tb = TIsTransposedMatrix<B>::value;
+    if (policy.algorithm == MULTIPLY_STRASSEN && a.is_square() && b.is_square() && a.rows() > policy.cutoff)
+    {
+        // Strassen adds row-major blocks, so a transposed operand is formed first:
+        // O(n^2) work against the O(n^2.81) product.
+        if (ta) return dense_product(TDynamicMatrix<T>(a, res), b, policy, ex, res);
+        if (tb) return dense_product(a, TDynamicMatrix<T>(b, res), policy, ex, res);
+    }
+
+    TDynamicMatrix<T> c(a.rows(), b.cols(), uninitialized, res);
+    if (policy.algorithm == MULTIPLY_STRASSEN && a.is_square() && b.is_square() && a.rows() > policy.cutoff)
+    {
+        const size_t wsLength = tkernels::strassen_workspace(a.rows(), policy.cutoff);
+        T* ws = tmemory::create_uninitialized<T>(res, wsLength);
+        try
+        {
+            tkernels::strassen(a.rows(), a.data(), leading_dimension(a), b.data(), leading_dimension(b),
+                               c.data(), c.get_stride(), policy.cutoff, ws, ex);
+        }
+        catch (...)
+        {
+            tmemory::destroy(res, ws, wsLength);
+            throw;
+        }
+        tmemory::destroy(res, ws, wsLength);
+    }
+    else
+        tkernels::gemm(ta, tb, a.rows(), b.cols(), a.cols(), a.data(), leading_dimension(a),
+                       b.data(), leading_dimension(b), c.data(), c.get_stride(), ex, false);
+    return c;
+}
+
+// Products are not element-wise, so expression operands are evaluated first.
+template<typename T>
+const TDynamicMatrix<T>& materialize(const TDynamicMatrix<T>& m)
+{
+    return m;
+}
+
+template<typename E>
+TDynamicMatrix<typename E::value_type> materialize(const TMatrixExpr<E>& e)
+{
+    return TDynamicMatrix<typename E::value_type>(e);
+}
+
+template<typename T>
+const TMatrixView<T>& materialize(const TMatrixView<T>& m)
+{
+    return m;
+}
+
+template<typename T>
+const TTransposedView<T>& materialize(const TTransposedView<T>& m)
+{
+    return m;
+}
+
+template<typename T>
+const TDynamicVector<T>& materialize(const TDynamicVector<T>& v)
+{
+    return v;
+}
+
+template<typename E>
+TDynamicVector<typename E::value_type> materialize(const TVectorExpr<E>& e)
+{
+    return TDynamicVector<typename E::value_type>(e);
+}
+
+template<typename L, typename R>
+TDynamicMatrix<typename L::value_type> operator*(const TMatrixExpr<L>& l, const TMatrixExpr<R>& r)
+{
+    return materialize(l.self()).multiply(materialize(r.self()), matrix_executor());
+}
+
+template<typename L, typename R>
+TDynamicVector<typename L::value_type> operator*(const TMatrixExpr<L>& l, const TVectorExpr<R>& r)
+{
+    const auto& m = materialize(l.self());
+    const auto& v = materialize(r.self());
+    if (v.length() != m.cols())
+        throw length_error("Vector and Matrix dimensions incompatible");
+
+    TDynamicVector<typename L::value_type> res(m.rows(), uninitialized);
+    tkernels::gemv(m.rows(), m.cols(), m.data(), m.get_stride(), v.data(), res.data(), matrix_executor());
+    return res;
+}
+
+// v^T A, the row vector times a matrix.
+template<typename L, typename R>
+TDynamicVector<typename L::value_type> operator*(const TVectorExpr<L>& l, const TMatrixExpr<R>& r)
+{
+    const auto& v = materialize(l.self());
+    const auto& m = materialize(r.self());
+    if (v.length() != m.rows())
+        throw length_error("Vector and Matrix dimensions incompatible");
+
+    TDynamicVector<typename L::value_type> res(m.cols(), uninitialized);
+    tkernels::gemv_t(m.rows(), m.cols(), m.data(), m.get_stride(), v.data(), res.data(), matrix_executor());
+    return res;
+}
+
+// With a transposed matrix the two GEMV kernels swap roles: A^T x is x^T A.
+template<typename T, typename R>
+TDynamicVector<T> operator*(const TTransposedView<T>& l, const TVectorExpr<R>& r)
+{
+    const auto& v = materialize(r.self());
+    if (v.length() != l.cols())
+        throw length_error("Vector and Matrix dimensions incompatible");
+
+    TDynamicVector<T> res(l.rows(), uninitialized);
+    tkernels::gemv_t(l.cols(), l.rows(), l.data(), l.source_stride(), v.data(), res.data(), matrix_executor());
+    return res;
+}
+
+template<typename L, typename T>
+TDynamicVector<T> operator*(const TVectorExpr<L>& l, const TTransposedView<T>& r)
+{
+    const auto& v = materialize(l.self());
+    if (v.length() != r.rows())
+        throw length_error("Vector and Matrix dimensions incompatible");
+
+    TDynamicVector<T> res(r.cols(), uninitialized);
+    tkernels::gemv(r.cols(), r.rows(), r.data(), r.source_stride(), v.data(), res.data(), matrix_executor());
+    return res;
+}
+
+// Operators on rvalue containers reuse the storage of the temporary as the result:
+// the expression is evaluated in place, element by element, into the operand that
+// is about to die, so e.g. f(x) + a + b allocates nothing beyond the result of f.
+template<typename T, typename R>
+TDynamicVector<T> operator+(TDynamicVector<T>&& l, const TVectorExpr<R>& r)
+{
+    l = l + r.self();
+    return std::move(l);
+}
+
+template<typename T, typename L>
+TDynamicVector<T> operator+(const TVectorExpr<L>& l, TDynamicVector<T>&& r)
+{
+    r = l.self() + r;
+    return std::move(r);
+}
+
+template<typename T>
+TDynamicVector<T> operator+(TDynamicVector<T>&& l, TDynamicVector<T>&& r)
+{
+    l = l + r;
+    return std::move(l);
+}
+
+template<typename T, typename R>
+TDynamicVector<T> operator-(TDynamicVector<T>&& l, const TVectorExpr<R>& r)
+{
+    l = l - r.self();
+    return std::move(l);
+}
+
+template<typename T, typename L>
+TDynamicVector<T> operator-(const TVectorExpr<L>& l, TDynamicVector<T>&& r)
+{
+    r = l.self() - r;
+    return std::move(r);
+}
+
+template<typename T>
+TDynamicVector<T> operator-(TDynamicVector<T>&& l, TDynamicVector<T>&& r)
+{
+    l = l - r;
+    return std::move(l);
+}
+
+template<typename T>
+TDynamicVector<T> operator+(TDynamicVector<T>&& v, const T& val)
+{
+    v = v + val;
+    return std::move(v);
+}
+
+template<typename T>
+TDynamicVector<T> operator-(TDynamicVector<T>&& v, const T& val)
+{
+    v = v - val;
+    return std::move(v);
+}
+
+template<typename T>
+TDynamicVector<T> operator*(TDynamicVector<T>&& v, const T& val)
+{
+    v *= val;
+    return std::move(v);
+}
+
+template<typename T>
+TDynamicVector<T> operator*(const T& val, TDynamicVector<T>&& v)
+{
+    v *= val;
+    return std::move(v);
+}
+
+const size_t DOT_MAX_BLOCKS = 64;
+
+// Dot product of two vectors. A long one is summed in blocks whose count depends
+// only on the length, and the block sums are added in order, so the result is the
+// same whatever executor does the work.
+template<typename T>
+T operator*(const TDynamicVector<T>& l, const TDynamicVector<T>& r)
+{
+    const size_t n = l.length();
+    if (r.length() != n) throw length_error("Vector lengths mismatch");
+
+    const size_t nBlocks = std::min(DOT_MAX_BLOCKS, n / PARALLEL_GRAIN);
+    if (nBlocks < 2) return tsimd::dot(n, l.data(), r.data());
+
+    T partial[DOT_MAX_BLOCKS];
+    matrix_executor().parallel_for(nBlocks, [&](size_t b)
+    {
+        const size_t begin = n * b / nBlocks, end = n * (b + 1) / nBlocks;
+        partial[b] = tsimd::dot(end - begin, l.data() + begin, r.data() + begin);
+    });
+
+    T sum = T();
+    for (size_t b = 0; b < nBlocks; ++b) sum += partial[b];
+    return sum;
+}
+
+template<typename T, typename R>
+TDynamicMatrix<T> operator+(TDynamicMatrix<T>&& l, const TMatrixExpr<R>& r)
+{
+    l = l + r.self();
+    return std::move(l);
+}
+
+template<typename T, typename L>
+TDynamicMatrix<T> operator+(const TMatrixExpr<L>& l, TDynamicMatrix<T>&& r)
+{
+    r = l.self() + r;
+    return std::move(r);
+}
+
+template<typename T>
+TDynamicMatrix<T> operator+(TDynamicMatrix<T>&& l, TDynamicMatrix<T>&& r)
+{
+    l = l + r;
+    return std::move(l);
+}
+
+template<typename T, typename R>
+TDynamicMatrix<T> operator-(TDynamicMatrix<T>&& l, const TMatrixExpr<R>& r)
+{
+    l = l - r.self();
+    return std::move(l);
+}
+
+template<typename T, typename L>
+TDynamicMatrix<T> operator-(const TMatrixExpr<L>& l, TDynamicMatrix<T>&& r)
+{
+    r = l.self() - r;
+    return std::move(r);
+}
+
+template<typename T>
+TDynamicMatrix<T> operator-(TDynamicMatrix<T>&& l, TDynamicMatrix<T>&& r)
+{
+    l = l - r;
+    return std::move(l);
+}
+
+template<typename T>
+TDynamicMatrix<T> operator*(TDynamicMatrix<T>&& m, const T& val)
+{
+    m *= val;
+    return std::move(m);
+}
+
+template<typename T>
+TDynamicMatrix<T> operator*(const T& val, TDynamicMatrix<T>&& m)
+{
+    m *= val;
+    return std::move(m);
+}
 
 #endif
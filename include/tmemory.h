@@ -0,0 +1,262 @@
+#ifndef __TMemory_H__
+#define __TMemory_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <memory_resource>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Element storage of vectors and matrices. Every buffer comes from a
+// std::pmr::memory_resource, so temporaries can be placed in a monotonic arena,
+// a size-class pool or huge pages instead of going through malloc.
+namespace tmemory
+{
+
+// Buffers start on a cache line, which is also the widest SIMD register (AVX-512).
+const size_t ALIGNMENT = 64;
+
+template<typename T>
+constexpr size_t alignment() noexcept
+{
+    return std::max(alignof(T), ALIGNMENT);
+}
+
+// a * b, or std::length_error when the product does not fit in size_t.
+inline size_t checked_mul(size_t a, size_t b)
+{
+    if (b != 0 && a > SIZE_MAX / b) throw std::length_error("Element count overflows size_t");
+    return a * b;
+}
+
+// Smallest length >= n whose size in bytes is a whole number of cache lines,
+// used as the row stride of matrices so that every row starts aligned.
+template<typename T>
+size_t padded_length(size_t n)
+{
+    const size_t step = ALIGNMENT / std::gcd(ALIGNMENT, sizeof(T));
+    if (n > SIZE_MAX - (step - 1)) throw std::length_error("Element count overflows size_t");
+    return (n + step - 1) / step * step;
+}
+
+template<typename T>
+T* allocate(std::pmr::memory_resource* res, size_t n)
+{
+    return static_cast<T*>(res->allocate(checked_mul(n, sizeof(T)), alignment<T>()));
+}
+
+template<typename T>
+void deallocate(std::pmr::memory_resource* res, T* p, size_t n) noexcept
+{
+    res->deallocate(p, n * sizeof(T), alignment<T>());
+}
+
+// Value-initialized buffer: arithmetic elements are zeroed.
+template<typename T>
+T* create(std::pmr::memory_resource* res, size_t n)
+{
+    T* p = allocate<T>(res, n);
+    try
+    {
+        std::uninitialized_value_construct_n(p, n);
+    }
+    catch (...)
+    {
+        deallocate(res, p, n);
+        throw;
+    }
+    return p;
+}
+
+// Default-initialized buffer: arithmetic elements are left indeterminate.
+template<typename T>
+T* create_uninitialized(std::pmr::memory_resource* res, size_t n)
+{
+    T* p = allocate<T>(res, n);
+    try
+    {
+        std::uninitialized_default_construct_n(p, n);
+    }
+    catch (...)
+    {
+        deallocate(res, p, n);
+        throw;
+    }
+    return p;
+}
+
+template<typename T>
+T* create_copy(std::pmr::memory_resource* res, const T* src, size_t n)
+{
+    T* p = allocate<T>(res, n);
+    try
+    {
+        std::uninitialized_copy_n(src, n, p);
+    }
+    catch (...)
+    {
+        deallocate(res, p, n);
+        throw;
+    }
+    return p;
+}
+
+template<typename T>
+void destroy(std::pmr::memory_resource* res, T* p, size_t n) noexcept
+{
+    if (p == nullptr) return;
+    std::destroy_n(p, n);
+    deallocate(res, p, n);
+}
+
+// Owner of a buffer that a vector or matrix wraps but did not allocate from its
+// resource: release() is called exactly once, when the container lets go of it.
+class TExternalBuffer
+{
+public:
+    virtual void release() noexcept = 0;
+
+protected:
+    ~TExternalBuffer() {}
+};
+
+// Borrowed memory stays with the caller, so releasing it does nothing.
+inline TExternalBuffer* borrowed_buffer() noexcept
+{
+    struct TBorrowedBuffer final : TExternalBuffer
+    {
+        void release() noexcept override {}
+    };
+    static TBorrowedBuffer buffer;
+    return &buffer;
+}
+
+// Adopted memory is handed to the caller's deleter. The buffer deletes itself
+// through its own type, which is why it is final.
+template<typename T, typename D>
+class TAdoptedBuffer final : public TExternalBuffer
+{
+    T* p;
+    D deleter;
+
+public:
+    TAdoptedBuffer(T* _p, D _deleter) : p(_p), deleter(std::move(_deleter)) {}
+
+    void release() noexcept override
+    {
+        deleter(p);
+        delete this;
+    }
+};
+
+// Like std::shared_ptr, takes ownership even when it throws: p is then deleted.
+template<typename T, typename D>
+TExternalBuffer* adopt_buffer(T* p, D deleter)
+{
+    try
+    {
+        return new TAdoptedBuffer<T, D>(p, std::move(deleter));
+    }
+    catch (...)
+    {
+        deleter(p);
+        throw;
+    }
+}
+
+}
+
+// Serves large blocks from anonymous mappings advised to use transparent huge
+// pages, and everything else from the upstream resource. On systems without
+// madvise(MADV_HUGEPAGE) all requests go upstream.
+class THugePageResource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource* upstream;
+    size_t threshold;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    static size_t mapped_length(size_t bytes) noexcept
+    {
+        static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        return (bytes + page - 1) / page * page;
+    }
+#endif
+
+public:
+    static const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    explicit THugePageResource(std::pmr::memory_resource* _upstream = std::pmr::get_default_resource(),
+                               size_t _threshold = HUGE_PAGE_SIZE)
+        : upstream(_upstream), threshold(_threshold) {}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (bytes >= threshold && alignment <= HUGE_PAGE_SIZE)
+        {
+            // Over-map by one huge page so the block can start on a huge page boundary,
+            // then return the unused head and tail.
+            const size_t length = mapped_length(bytes);
+            const size_t mapped = length + HUGE_PAGE_SIZE;
+            void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+
+            char* base = static_cast<char*>(p);
+            char* aligned = reinterpret_cast<char*>(
+                (reinterpret_cast<uintptr_t>(base) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+            if (aligned != base) munmap(base, aligned - base);
+            if (aligned + length != base + mapped) munmap(aligned + length, base + mapped - (aligned + length));
+            madvise(aligned, length, MADV_HUGEPAGE);
+            return aligned;
+        }
+#endif
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (bytes >= threshold && alignment <= HUGE_PAGE_SIZE)
+        {
+            munmap(p, mapped_length(bytes));
+            return;
+        }
+#endif
+        upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// Makes res the default resource, which new vectors and matrices allocate from,
+// until the end of the scope; e.g. a std::pmr::monotonic_buffer_resource for
+// the temporaries of one request. Not thread-safe: the default is process-wide.
+class TDefaultResourceScope
+{
+    std::pmr::memory_resource* previous;
+
+public:
+    explicit TDefaultResourceScope(std::pmr::memory_resource* res)
+        : previous(std::pmr::set_default_resource(res)) {}
+
+    TDefaultResourceScope(const TDefaultResourceScope&) = delete;
+    TDefaultResourceScope& operator=(const TDefaultResourceScope&) = delete;
+
+    ~TDefaultResourceScope() { std::pmr::set_default_resource(previous); }
+};
+
+#endif
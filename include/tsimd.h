@@ -0,0 +1,764 @@
+#ifndef __TSimd_H__
+#define __TSimd_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TSIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define TSIMD_X86 0
+#endif
+
+// Element-wise vector kernels for float, double, 32- and 64-bit integers. The
+// instruction set is picked at run time from the CPU features; every other type,
+// and every CPU without SSE2, goes through the plain scalar loops.
+namespace tsimd
+{
+
+enum TSimdLevel
+{
+    SIMD_SCALAR = 0,
+    SIMD_SSE2 = 1,
+    SIMD_AVX2 = 2,
+    SIMD_AVX512 = 3
+};
+
+inline TSimdLevel detect_simd_level() noexcept
+{
+#if TSIMD_X86 && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+        avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 17)) != 0 &&
+                 (xcr0 & 0xe6) == 0xe6;
+    }
+    if (avx512) return SIMD_AVX512;
+    if (avx2) return SIMD_AVX2;
+    if (sse2) return SIMD_SSE2;
+#elif TSIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+inline TSimdLevel& active_simd_level() noexcept
+{
+    static TSimdLevel level = detect_simd_level();
+    return level;
+}
+
+inline TSimdLevel simd_level() noexcept { return active_simd_level(); }
+
+// Restricts the kernels to a lower instruction set, e.g. to test every path on one CPU.
+inline void set_simd_level(TSimdLevel level) noexcept
+{
+    const TSimdLevel supported = detect_simd_level();
+    active_simd_level() = level < supported ? level : supported;
+}
+
+// Maps a type onto the lane descriptions of every instruction set; integers are
+// handled by width, since two's complement add, sub and mul do not depend on sign.
+// MUL_LEVEL is the lowest level with a native vector multiply.
+template<typename T, typename = void>
+struct TSimdLanes
+{
+    static const bool supported = false;
+};
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+add(size_t n, const T* a, const T* b, T* r)
+{
+    for (size_t i = 0; i < n; ++i) r[i] = a[i] + b[i];
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+sub(size_t n, const T* a, const T* b, T* r)
+{
+    for (size_t i = 0; i < n; ++i) r[i] = a[i] - b[i];
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+scale(size_t n, const T* a, T s, T* r)
+{
+    for (size_t i = 0; i < n; ++i) r[i] = a[i] * s;
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+axpy(size_t n, T alpha, const T* x, T* y)
+{
+    for (size_t i = 0; i < n; ++i) y[i] += alpha * x[i];
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+mul_add(size_t n, const T* a, const T* b, T* r)
+{
+    for (size_t i = 0; i < n; ++i) r[i] += a[i] * b[i];
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported, T>::type
+dot(size_t n, const T* a, const T* b)
+{
+    T sum = T();
+    for (size_t i = 0; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+template<typename T>
+typename std::enable_if<!TSimdLanes<T>::supported>::type
+dot4(size_t n, const T* a0, const T* a1, const T* a2, const T* a3, const T* b, T* r)
+{
+    r[0] = dot(n, a0, b);
+    r[1] = dot(n, a1, b);
+    r[2] = dot(n, a2, b);
+    r[3] = dot(n, a3, b);
+}
+
+// Edge of the square tile that transpose_tile() transposes with vector shuffles at
+// the active level: 8 x 8 float and 4 x 4 double with AVX2, half that with SSE2.
+// It is 0 for types without such a tile, which callers transpose element-wise.
+template<typename T>
+size_t transpose_tile_size() noexcept
+{
+    return 0;
+}
+
+// b[j * ldb + i] = a[i * lda + j] for one transpose_tile_size<T>() tile.
+template<typename T>
+void transpose_tile(const T* a, size_t lda, T* b, size_t ldb)
+{
+    const size_t n = transpose_tile_size<T>();
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            b[j * ldb + i] = a[i * lda + j];
+}
+
+#if TSIMD_X86
+
+// Loops shared by every instruction set. L describes one register type: its
+// lane type T, width W and load/store/arithmetic operations.
+#define TSIMD_DEFINE_LOOPS                                                         \
+    template<class L>                                                              \
+    void add(size_t n, const typename L::T* a, const typename L::T* b,             \
+             typename L::T* r)                                                     \
+    {                                                                              \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+            L::store(r + i, L::add(L::load(a + i), L::load(b + i)));               \
+        for (; i < n; ++i) r[i] = a[i] + b[i];                                     \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    void sub(size_t n, const typename L::T* a, const typename L::T* b,             \
+             typename L::T* r)                                                     \
+    {                                                                              \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+            L::store(r + i, L::sub(L::load(a + i), L::load(b + i)));               \
+        for (; i < n; ++i) r[i] = a[i] - b[i];                                     \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    void scale(size_t n, const typename L::T* a, typename L::T s,                  \
+               typename L::T* r)                                                   \
+    {                                                                              \
+        const typename L::V vs = L::set1(s);                                       \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+            L::store(r + i, L::mul(L::load(a + i), vs));                           \
+        for (; i < n; ++i) r[i] = a[i] * s;                                        \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    void axpy(size_t n, typename L::T alpha, const typename L::T* x,               \
+              typename L::T* y)                                                    \
+    {                                                                              \
+        const typename L::V va = L::set1(alpha);                                   \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+            L::store(y + i, L::add(L::load(y + i), L::mul(va, L::load(x + i))));   \
+        for (; i < n; ++i) y[i] += alpha * x[i];                                   \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    void mul_add(size_t n, const typename L::T* a, const typename L::T* b,         \
+                 typename L::T* r)                                                 \
+    {                                                                              \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+            L::store(r + i, L::add(L::load(r + i),                                 \
+                                   L::mul(L::load(a + i), L::load(b + i))));       \
+        for (; i < n; ++i) r[i] += a[i] * b[i];                                    \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    typename L::T reduce(typename L::V v)                                          \
+    {                                                                              \
+        typename L::T lanes[L::W];                                                 \
+        L::store(lanes, v);                                                        \
+        typename L::T sum = typename L::T();                                       \
+        for (size_t k = 0; k < L::W; ++k) sum += lanes[k];                         \
+        return sum;                                                                \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    typename L::T dot(size_t n, const typename L::T* a, const typename L::T* b)    \
+    {                                                                              \
+        typename L::V acc0 = L::set1(0), acc1 = L::set1(0);                        \
+        size_t i = 0;                                                              \
+        for (; i + 2 * L::W <= n; i += 2 * L::W)                                   \
+        {                                                                          \
+            acc0 = L::add(acc0, L::mul(L::load(a + i), L::load(b + i)));           \
+            acc1 = L::add(acc1, L::mul(L::load(a + i + L::W),                      \
+                                       L::load(b + i + L::W)));                    \
+        }                                                                          \
+        for (; i + L::W <= n; i += L::W)                                           \
+            acc0 = L::add(acc0, L::mul(L::load(a + i), L::load(b + i)));           \
+        typename L::T sum = reduce<L>(L::add(acc0, acc1));                         \
+        for (; i < n; ++i) sum += a[i] * b[i];                                     \
+        return sum;                                                                \
+    }                                                                              \
+                                                                                   \
+    template<class L>                                                              \
+    void dot4(size_t n, const typename L::T* a0, const typename L::T* a1,          \
+              const typename L::T* a2, const typename L::T* a3,                    \
+              const typename L::T* b, typename L::T* r)                            \
+    {                                                                              \
+        typename L::V acc0 = L::set1(0), acc1 = L::set1(0);                        \
+        typename L::V acc2 = L::set1(0), acc3 = L::set1(0);                        \
+        size_t i = 0;                                                              \
+        for (; i + L::W <= n; i += L::W)                                           \
+        {                                                                          \
+            const typename L::V vb = L::load(b + i);                               \
+            acc0 = L::add(acc0, L::mul(L::load(a0 + i), vb));                      \
+            acc1 = L::add(acc1, L::mul(L::load(a1 + i), vb));                      \
+            acc2 = L::add(acc2, L::mul(L::load(a2 + i), vb));                      \
+            acc3 = L::add(acc3, L::mul(L::load(a3 + i), vb));                      \
+        }                                                                          \
+        r[0] = reduce<L>(acc0);                                                    \
+        r[1] = reduce<L>(acc1);                                                    \
+        r[2] = reduce<L>(acc2);                                                    \
+        r[3] = reduce<L>(acc3);                                                    \
+        for (; i < n; ++i)                                                         \
+        {                                                                          \
+            r[0] += a0[i] * b[i];                                                  \
+            r[1] += a1[i] * b[i];                                                  \
+            r[2] += a2[i] * b[i];                                                  \
+            r[3] += a3[i] * b[i];                                                  \
+        }                                                                          \
+    }
+
+// Lane-by-lane multiply for integer widths the instruction set cannot multiply.
+#define TSIMD_EMULATED_MUL(V, T, W)                                                \
+    static V mul(V a, V b)                                                         \
+    {                                                                              \
+        T x[W], y[W];                                                              \
+        store(x, a);                                                               \
+        store(y, b);                                                               \
+        for (size_t k = 0; k < W; ++k) x[k] = T(x[k] * y[k]);                      \
+        return load(x);                                                            \
+    }
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace sse2
+{
+
+struct f32
+{
+    typedef float T;
+    typedef __m128 V;
+    static const size_t W = 4;
+    static V load(const T* p) { return _mm_loadu_ps(p); }
+    static void store(T* p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(T s) { return _mm_set1_ps(s); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+};
+
+struct f64
+{
+    typedef double T;
+    typedef __m128d V;
+    static const size_t W = 2;
+    static V load(const T* p) { return _mm_loadu_pd(p); }
+    static void store(T* p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(T s) { return _mm_set1_pd(s); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+};
+
+struct i32
+{
+    typedef int32_t T;
+    typedef __m128i V;
+    static const size_t W = 4;
+    static V load(const T* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+    static V set1(T s) { return _mm_set1_epi32(s); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm_sub_epi32(a, b); }
+    TSIMD_EMULATED_MUL(V, T, W)
+};
+
+struct i64
+{
+    typedef int64_t T;
+    typedef __m128i V;
+    static const size_t W = 2;
+    static V load(const T* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+    static V set1(T s) { return _mm_set_epi64x(s, s); }
+    static V add(V a, V b) { return _mm_add_epi64(a, b); }
+    static V sub(V a, V b) { return _mm_sub_epi64(a, b); }
+    TSIMD_EMULATED_MUL(V, T, W)
+};
+
+TSIMD_DEFINE_LOOPS
+
+// b[j * ldb + i] = a[i * lda + j] for a 4 x 4 float and a 2 x 2 double tile.
+inline void transpose_tile(const float* a, size_t lda, float* b, size_t ldb)
+{
+    __m128 r0 = _mm_loadu_ps(a), r1 = _mm_loadu_ps(a + lda);
+    __m128 r2 = _mm_loadu_ps(a + 2 * lda), r3 = _mm_loadu_ps(a + 3 * lda);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(b, r0);
+    _mm_storeu_ps(b + ldb, r1);
+    _mm_storeu_ps(b + 2 * ldb, r2);
+    _mm_storeu_ps(b + 3 * ldb, r3);
+}
+
+inline void transpose_tile(const double* a, size_t lda, double* b, size_t ldb)
+{
+    const __m128d r0 = _mm_loadu_pd(a), r1 = _mm_loadu_pd(a + lda);
+    _mm_storeu_pd(b, _mm_unpacklo_pd(r0, r1));
+    _mm_storeu_pd(b + ldb, _mm_unpackhi_pd(r0, r1));
+}
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2
+{
+
+struct f32
+{
+    typedef float T;
+    typedef __m256 V;
+    static const size_t W = 8;
+    static V load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(T s) { return _mm256_set1_ps(s); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+};
+
+struct f64
+{
+    typedef double T;
+    typedef __m256d V;
+    static const size_t W = 4;
+    static V load(const T* p) { return _mm256_loadu_pd(p); }
+    static void store(T* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(T s) { return _mm256_set1_pd(s); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+};
+
+struct i32
+{
+    typedef int32_t T;
+    typedef __m256i V;
+    static const size_t W = 8;
+    static V load(const T* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static V set1(T s) { return _mm256_set1_epi32(s); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+    static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+};
+
+struct i64
+{
+    typedef int64_t T;
+    typedef __m256i V;
+    static const size_t W = 4;
+    static V load(const T* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static V set1(T s) { return _mm256_set1_epi64x(s); }
+    static V add(V a, V b) { return _mm256_add_epi64(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi64(a, b); }
+    TSIMD_EMULATED_MUL(V, T, W)
+};
+
+TSIMD_DEFINE_LOOPS
+
+// b[j * ldb + i] = a[i * lda + j] for an 8 x 8 float and a 4 x 4 double tile:
+// interleave pairs of rows, then pairs of pairs, then swap 128-bit halves.
+inline void transpose_tile(const float* a, size_t lda, float* b, size_t ldb)
+{
+    __m256 r[8], t[8];
+    for (size_t i = 0; i < 8; ++i) r[i] = _mm256_loadu_ps(a + i * lda);
+    for (size_t i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+    }
+    for (size_t i = 0; i < 8; i += 4)
+    {
+        r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (size_t j = 0; j < 4; ++j)
+    {
+        _mm256_storeu_ps(b + j * ldb, _mm256_permute2f128_ps(r[j], r[j + 4], 0x20));
+        _mm256_storeu_ps(b + (j + 4) * ldb, _mm256_permute2f128_ps(r[j], r[j + 4], 0x31));
+    }
+}
+
+inline void transpose_tile(const double* a, size_t lda, double* b, size_t ldb)
+{
+    const __m256d r0 = _mm256_loadu_pd(a), r1 = _mm256_loadu_pd(a + lda);
+    const __m256d r2 = _mm256_loadu_pd(a + 2 * lda), r3 = _mm256_loadu_pd(a + 3 * lda);
+    const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+    const __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+    _mm256_storeu_pd(b, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(b + ldb, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(b + 2 * ldb, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(b + 3 * ldb, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx512f,avx512dq"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512dq")
+#endif
+
+namespace avx512
+{
+
+struct f32
+{
+    typedef float T;
+    typedef __m512 V;
+    static const size_t W = 16;
+    static V load(const T* p) { return _mm512_loadu_ps(p); }
+    static void store(T* p, V v) { _mm512_storeu_ps(p, v); }
+    static V set1(T s) { return _mm512_set1_ps(s); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+};
+
+struct f64
+{
+    typedef double T;
+    typedef __m512d V;
+    static const size_t W = 8;
+    static V load(const T* p) { return _mm512_loadu_pd(p); }
+    static void store(T* p, V v) { _mm512_storeu_pd(p, v); }
+    static V set1(T s) { return _mm512_set1_pd(s); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+};
+
+struct i32
+{
+    typedef int32_t T;
+    typedef __m512i V;
+    static const size_t W = 16;
+    static V load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, V v) { _mm512_storeu_si512(p, v); }
+    static V set1(T s) { return _mm512_set1_epi32(s); }
+    static V add(V a, V b) { return _mm512_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_epi32(a, b); }
+    static V mul(V a, V b) { return _mm512_mullo_epi32(a, b); }
+};
+
+struct i64
+{
+    typedef int64_t T;
+    typedef __m512i V;
+    static const size_t W = 8;
+    static V load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, V v) { _mm512_storeu_si512(p, v); }
+    static V set1(T s) { return _mm512_set1_epi64(s); }
+    static V add(V a, V b) { return _mm512_add_epi64(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_epi64(a, b); }
+    static V mul(V a, V b) { return _mm512_mullo_epi64(a, b); }
+};
+
+TSIMD_DEFINE_LOOPS
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#undef TSIMD_DEFINE_LOOPS
+#undef TSIMD_EMULATED_MUL
+
+template<>
+struct TSimdLanes<float>
+{
+    static const bool supported = true;
+    static const TSimdLevel MUL_LEVEL = SIMD_SSE2;
+    typedef float Lane;
+    typedef sse2::f32 Sse2;
+    typedef avx2::f32 Avx2;
+    typedef avx512::f32 Avx512;
+};
+
+template<>
+struct TSimdLanes<double>
+{
+    static const bool supported = true;
+    static const TSimdLevel MUL_LEVEL = SIMD_SSE2;
+    typedef double Lane;
+    typedef sse2::f64 Sse2;
+    typedef avx2::f64 Avx2;
+    typedef avx512::f64 Avx512;
+};
+
+template<typename T>
+struct TSimdLanes<T, typename std::enable_if<std::is_integral<T>::value &&
+    !std::is_same<T, bool>::value && sizeof(T) == 4>::type>
+{
+    static const bool supported = true;
+    static const TSimdLevel MUL_LEVEL = SIMD_AVX2;
+    typedef int32_t Lane;
+    typedef sse2::i32 Sse2;
+    typedef avx2::i32 Avx2;
+    typedef avx512::i32 Avx512;
+};
+
+template<typename T>
+struct TSimdLanes<T, typename std::enable_if<std::is_integral<T>::value &&
+    !std::is_same<T, bool>::value && sizeof(T) == 8>::type>
+{
+    static const bool supported = true;
+    static const TSimdLevel MUL_LEVEL = SIMD_AVX512;
+    typedef int64_t Lane;
+    typedef sse2::i64 Sse2;
+    typedef avx2::i64 Avx2;
+    typedef avx512::i64 Avx512;
+};
+
+template<typename T>
+using TSimdLane = typename TSimdLanes<T>::Lane;
+
+template<typename T>
+const TSimdLane<T>* lanes(const T* p) { return reinterpret_cast<const TSimdLane<T>*>(p); }
+
+template<typename T>
+TSimdLane<T>* lanes(T* p) { return reinterpret_cast<TSimdLane<T>*>(p); }
+
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+add(size_t n, const T* a, const T* b, T* r)
+{
+    typedef TSimdLanes<T> S;
+    switch (simd_level())
+    {
+    case SIMD_AVX512: avx512::add<typename S::Avx512>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_AVX2: avx2::add<typename S::Avx2>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_SSE2: sse2::add<typename S::Sse2>(n, lanes(a), lanes(b), lanes(r)); return;
+    default: for (size_t i = 0; i < n; ++i) r[i] = a[i] + b[i];
+    }
+}
+
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+sub(size_t n, const T* a, const T* b, T* r)
+{
+    typedef TSimdLanes<T> S;
+    switch (simd_level())
+    {
+    case SIMD_AVX512: avx512::sub<typename S::Avx512>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_AVX2: avx2::sub<typename S::Avx2>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_SSE2: sse2::sub<typename S::Sse2>(n, lanes(a), lanes(b), lanes(r)); return;
+    default: for (size_t i = 0; i < n; ++i) r[i] = a[i] - b[i];
+    }
+}
+
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+scale(size_t n, const T* a, T s, T* r)
+{
+    typedef TSimdLanes<T> S;
+    const TSimdLane<T> ls = TSimdLane<T>(s);
+    const TSimdLevel level = simd_level() >= S::MUL_LEVEL ? simd_level() : SIMD_SCALAR;
+    switch (level)
+    {
+    case SIMD_AVX512: avx512::scale<typename S::Avx512>(n, lanes(a), ls, lanes(r)); return;
+    case SIMD_AVX2: avx2::scale<typename S::Avx2>(n, lanes(a), ls, lanes(r)); return;
+    case SIMD_SSE2: sse2::scale<typename S::Sse2>(n, lanes(a), ls, lanes(r)); return;
+    default: for (size_t i = 0; i < n; ++i) r[i] = a[i] * s;
+    }
+}
+
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+axpy(size_t n, T alpha, const T* x, T* y)
+{
+    typedef TSimdLanes<T> S;
+    const TSimdLane<T> la = TSimdLane<T>(alpha);
+    const TSimdLevel level = simd_level() >= S::MUL_LEVEL ? simd_level() : SIMD_SCALAR;
+    switch (level)
+    {
+    case SIMD_AVX512: avx512::axpy<typename S::Avx512>(n, la, lanes(x), lanes(y)); return;
+    case SIMD_AVX2: avx2::axpy<typename S::Avx2>(n, la, lanes(x), lanes(y)); return;
+    case SIMD_SSE2: sse2::axpy<typename S::Sse2>(n, la, lanes(x), lanes(y)); return;
+    default: for (size_t i = 0; i < n; ++i) y[i] += alpha * x[i];
+    }
+}
+
+// r[i] += a[i] * b[i]
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+mul_add(size_t n, const T* a, const T* b, T* r)
+{
+    typedef TSimdLanes<T> S;
+    const TSimdLevel level = simd_level() >= S::MUL_LEVEL ? simd_level() : SIMD_SCALAR;
+    switch (level)
+    {
+    case SIMD_AVX512: avx512::mul_add<typename S::Avx512>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_AVX2: avx2::mul_add<typename S::Avx2>(n, lanes(a), lanes(b), lanes(r)); return;
+    case SIMD_SSE2: sse2::mul_add<typename S::Sse2>(n, lanes(a), lanes(b), lanes(r)); return;
+    default: for (size_t i = 0; i < n; ++i) r[i] += a[i] * b[i];
+    }
+}
+
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported, T>::type
+dot(size_t n, const T* a, const T* b)
+{
+    typedef TSimdLanes<T> S;
+    const TSimdLevel level = simd_level() >= S::MUL_LEVEL ? simd_level() : SIMD_SCALAR;
+    switch (level)
+    {
+    case SIMD_AVX512: return T(avx512::dot<typename S::Avx512>(n, lanes(a), lanes(b)));
+    case SIMD_AVX2: return T(avx2::dot<typename S::Avx2>(n, lanes(a), lanes(b)));
+    case SIMD_SSE2: return T(sse2::dot<typename S::Sse2>(n, lanes(a), lanes(b)));
+    default:
+    {
+        T sum = T();
+        for (size_t i = 0; i < n; ++i) sum += a[i] * b[i];
+        return sum;
+    }
+    }
+}
+
+// r[k] = dot(n, ak, b) for four rows at once, loading every element of b once.
+template<typename T>
+typename std::enable_if<TSimdLanes<T>::supported>::type
+dot4(size_t n, const T* a0, const T* a1, const T* a2, const T* a3, const T* b, T* r)
+{
+    typedef TSimdLanes<T> S;
+    const TSimdLevel level = simd_level() >= S::MUL_LEVEL ? simd_level() : SIMD_SCALAR;
+    TSimdLane<T> lr[4];
+    switch (level)
+    {
+    case SIMD_AVX512: avx512::dot4<typename S::Avx512>(n, lanes(a0), lanes(a1), lanes(a2), lanes(a3), lanes(b), lr); break;
+    case SIMD_AVX2: avx2::dot4<typename S::Avx2>(n, lanes(a0), lanes(a1), lanes(a2), lanes(a3), lanes(b), lr); break;
+    case SIMD_SSE2: sse2::dot4<typename S::Sse2>(n, lanes(a0), lanes(a1), lanes(a2), lanes(a3), lanes(b), lr); break;
+    default:
+        for (size_t k = 0; k < 4; ++k) lr[k] = TSimdLane<T>();
+        for (size_t i = 0; i < n; ++i)
+        {
+            lr[0] += a0[i] * b[i];
+            lr[1] += a1[i] * b[i];
+            lr[2] += a2[i] * b[i];
+            lr[3] += a3[i] * b[i];
+        }
+    }
+    for (size_t k = 0; k < 4; ++k) r[k] = T(lr[k]);
+}
+
+template<>
+inline size_t transpose_tile_size<float>() noexcept
+{
+    return simd_level() >= SIMD_AVX2 ? 8 : simd_level() == SIMD_SSE2 ? 4 : 0;
+}
+
+template<>
+inline size_t transpose_tile_size<double>() noexcept
+{
+    return simd_level() >= SIMD_AVX2 ? 4 : simd_level() == SIMD_SSE2 ? 2 : 0;
+}
+
+template<>
+inline void transpose_tile<float>(const float* a, size_t lda, float* b, size_t ldb)
+{
+    if (simd_level() >= SIMD_AVX2)
+        avx2::transpose_tile(a, lda, b, ldb);
+    else if (simd_level() == SIMD_SSE2)
+        sse2::transpose_tile(a, lda, b, ldb);
+}
+
+template<>
+inline void transpose_tile<double>(const double* a, size_t lda, double* b, size_t ldb)
+{
+    if (simd_level() >= SIMD_AVX2)
+        avx2::transpose_tile(a, lda, b, ldb);
+    else if (simd_level() == SIMD_SSE2)
+        sse2::transpose_tile(a, lda, b, ldb);
+}
+
+#endif
+
+}
+
+#endif
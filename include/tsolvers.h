@@ -0,0 +1,411 @@
+#ifndef __TSolvers_H__
+#define __TSolvers_H__
+
+#include <cmath>
+#include <vector>
+#include "tmatrix.h"
+#include "tsparsematrix.h"
+
+// Krylov solvers for A x = b that only touch A through y = A x. The operator is any
+// callable op(x, y) writing A x into the existing vector y, so dense, banded,
+// sparse and matrix-free operators all work; linear_operator(m) adapts a matrix
+// with a multiply(x, res) member. A preconditioner is a callable m(r, z) writing
+// M^-1 r into z.
+//
+// Every work vector is allocated before the first iteration; an iteration itself
+// is dot products and in-place vector updates, split across matrix_executor() like
+// any other vector operation, plus one or two operator and preconditioner
+// applications, none of which allocate.
+
+// The solvers stop once ||b - A x|| <= tolerance * ||b|| or after max_iterations
+// iterations. restart is the Krylov dimension of GMRES.
+struct TSolverOptions
+{
+    double tolerance = 1e-10;
+    size_t max_iterations = 1000;
+    size_t restart = 30;
+};
+
+// residual is the final ||b - A x|| / ||b|| as tracked by the solver.
+struct TSolverResult
+{
+    size_t iterations;
+    double residual;
+    bool converged;
+};
+
+template<typename M>
+class TLinearOperator
+{
+    const M& m;
+
+public:
+    explicit TLinearOperator(const M& _m) : m(_m) {}
+
+    template<typename T>
+    void operator()(const TDynamicVector<T>& x, TDynamicVector<T>& y) const
+    {
+        m.multiply(x, y);
+    }
+};
+
+// The matrix is referenced, not copied, and has to outlive the operator.
+template<typename M>
+TLinearOperator<M> linear_operator(const M& m)
+{
+    return TLinearOperator<M>(m);
+}
+
+struct TIdentityPreconditioner
+{
+    template<typename T>
+    void operator()(const TDynamicVector<T>& r, TDynamicVector<T>& z) const
+    {
+        z = r;
+    }
+};
+
+// M = diag(A).
+template<typename T>
+class TJacobiPreconditioner
+{
+    TDynamicVector<T> invDiag;
+
+public:
+    // M is any square matrix with a const element operator (i, i).
+    template<typename M>
+    explicit TJacobiPreconditioner(const M& a) : invDiag(a.rows(), uninitialized)
+    {
+        if (a.rows() != a.cols()) throw length_error("Preconditioner requires a square matrix");
+        for (size_t i = 0; i < a.rows(); ++i)
+        {
+            const T d = a(i, i);
+            if (d == T()) throw runtime_error("Zero diagonal element in Jacobi preconditioner");
+            invDiag[i] = T(1) / d;
+        }
+    }
+
+    void operator()(const TDynamicVector<T>& r, TDynamicVector<T>& z) const
+    {
+        const T* pr = r.data();
+        const T* pd = invDiag.data();
+        T* pz = z.data();
+        run_ranges(invDiag.length(), PARALLEL_GRAIN, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) pz[i] = pd[i] * pr[i];
+        });
+    }
+};
+
+// Incomplete LU without fill: L and U are restricted to the sparsity pattern of A,
+// and are kept together in a copy of it, L strictly below the diagonal with a unit
+// diagonal implied. Every row of A must store its diagonal element.
+template<typename T>
+class TILU0Preconditioner
+{
+    TCsrMatrix<T> lu;
+    std::vector<size_t> diag;
+
+public:
+    explicit TILU0Preconditioner(const TCsrMatrix<T>& a) : lu(a), diag(a.rows())
+    {
+        const size_t n = a.rows();
+        if (n != a.cols()) throw length_error("Preconditioner requires a square matrix");
+
+        const size_t* rowPtr = lu.row_ptr();
+        const size_t* colInd = lu.col_indices();
+        T* val = lu.data();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const size_t* it = std::lower_bound(colInd + rowPtr[i], colInd + rowPtr[i + 1], i);
+            if (it == colInd + rowPtr[i + 1] || *it != i)
+                throw runtime_error("ILU(0) requires every diagonal element to be stored");
+            diag[i] = it - colInd;
+        }
+
+        // IKJ order: row i is eliminated against the already finished rows k < i, and
+        // only positions present in row i are updated. pos maps a column to its
+        // position in row i.
+        const size_t none = SIZE_MAX;
+        std::vector<size_t> pos(n, none);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t p = rowPtr[i]; p < rowPtr[i + 1]; ++p) pos[colInd[p]] = p;
+            for (size_t p = rowPtr[i]; p < diag[i]; ++p)
+            {
+                const size_t k = colInd[p];
+                const T lik = val[p] /= val[diag[k]];
+                for (size_t q = diag[k] + 1; q < rowPtr[k + 1]; ++q)
+                    if (pos[colInd[q]] != none) val[pos[colInd[q]]] -= lik * val[q];
+            }
+            if (val[diag[i]] == T()) throw runtime_error("Zero pivot in ILU(0)");
+            for (size_t p = rowPtr[i]; p < rowPtr[i + 1]; ++p) pos[colInd[p]] = none;
+        }
+    }
+
+    // z = U^-1 L^-1 r, forward and back substitution over the stored rows.
+    void operator()(const TDynamicVector<T>& r, TDynamicVector<T>& z) const
+    {
+        const size_t n = lu.rows();
+        const size_t* rowPtr = lu.row_ptr();
+        const size_t* colInd = lu.col_indices();
+        const T* val = lu.data();
+        T* pz = z.data();
+        for (size_t i = 0; i < n; ++i)
+        {
+            T s = r[i];
+            for (size_t p = rowPtr[i]; p < diag[i]; ++p) s -= val[p] * pz[colInd[p]];
+            pz[i] = s;
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            T s = pz[i];
+            for (size_t p = diag[i] + 1; p < rowPtr[i + 1]; ++p) s -= val[p] * pz[colInd[p]];
+            pz[i] = s / val[diag[i]];
+        }
+    }
+};
+
+namespace tsolvers_detail
+{
+
+template<typename T>
+T norm(const TDynamicVector<T>& v)
+{
+    return std::sqrt(v * v);
+}
+
+// r = b - A x.
+template<typename T, typename Op>
+void residual(const Op& a, const TDynamicVector<T>& b, const TDynamicVector<T>& x, TDynamicVector<T>& r)
+{
+    a(x, r);
+    r = b - r;
+}
+
+template<typename T>
+void check_system(const TDynamicVector<T>& b, const TDynamicVector<T>& x)
+{
+    if (b.length() != x.length()) throw length_error("Vector dimensions mismatch");
+}
+
+} // namespace tsolvers_detail
+
+// Preconditioned conjugate gradient for symmetric positive definite A and M. x is
+// the initial guess on entry and the solution on return.
+template<typename T, typename Op, typename Pre>
+TSolverResult cg(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x, const Pre& m,
+                 const TSolverOptions& opts = TSolverOptions())
+{
+    using namespace tsolvers_detail;
+    check_system(b, x);
+
+    const size_t n = b.length();
+    TDynamicVector<T> r(n, uninitialized), z(n, uninitialized), p(n, uninitialized), q(n, uninitialized);
+    const T bnorm = norm(b);
+    if (bnorm == T())
+    {
+        std::fill(x.data(), x.data() + n, T());
+        return TSolverResult{0, 0, true};
+    }
+
+    residual(a, b, x, r);
+    double rel = double(norm(r) / bnorm);
+    if (rel <= opts.tolerance) return TSolverResult{0, rel, true};
+
+    m(r, z);
+    p = z;
+    T rz = r * z;
+    for (size_t it = 1; it <= opts.max_iterations; ++it)
+    {
+        a(p, q);
+        const T pq = p * q;
+        if (pq == T()) return TSolverResult{it, rel, false};
+        const T alpha = rz / pq;
+        x.axpy(alpha, p);
+        r.axpy(-alpha, q);
+
+        rel = double(norm(r) / bnorm);
+        if (rel <= opts.tolerance) return TSolverResult{it, rel, true};
+
+        m(r, z);
+        const T rzNew = r * z;
+        const T beta = rzNew / rz;
+        p = z + p * beta;
+        rz = rzNew;
+    }
+    return TSolverResult{opts.max_iterations, rel, false};
+}
+
+template<typename T, typename Op>
+TSolverResult cg(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x,
+                 const TSolverOptions& opts = TSolverOptions())
+{
+    return cg(a, b, x, TIdentityPreconditioner(), opts);
+}
+
+// BiCGSTAB with right preconditioning, for general nonsymmetric A; each iteration
+// applies A and M twice. A breakdown (rho or (r0, v) becoming zero) stops the
+// solver without convergence.
+template<typename T, typename Op, typename Pre>
+TSolverResult bicgstab(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x, const Pre& m,
+                       const TSolverOptions& opts = TSolverOptions())
+{
+    using namespace tsolvers_detail;
+    check_system(b, x);
+
+    const size_t n = b.length();
+    TDynamicVector<T> r(n, uninitialized), r0(n, uninitialized), p(n), v(n);
+    TDynamicVector<T> ph(n, uninitialized), s(n, uninitialized), sh(n, uninitialized), t(n, uninitialized);
+    const T bnorm = norm(b);
+    if (bnorm == T())
+    {
+        std::fill(x.data(), x.data() + n, T());
+        return TSolverResult{0, 0, true};
+    }
+
+    residual(a, b, x, r);
+    double rel = double(norm(r) / bnorm);
+    if (rel <= opts.tolerance) return TSolverResult{0, rel, true};
+
+    r0 = r;
+    T rho = T(1), alpha = T(1), omega = T(1);
+    for (size_t it = 1; it <= opts.max_iterations; ++it)
+    {
+        const T rhoNew = r0 * r;
+        if (rhoNew == T()) return TSolverResult{it, rel, false};
+
+        const T beta = (rhoNew / rho) * (alpha / omega);
+        p = r + (p - v * omega) * beta;
+        rho = rhoNew;
+
+        m(p, ph);
+        a(ph, v);
+        const T r0v = r0 * v;
+        if (r0v == T()) return TSolverResult{it, rel, false};
+        alpha = rho / r0v;
+
+        s = r - v * alpha;
+        x.axpy(alpha, ph);
+        rel = double(norm(s) / bnorm);
+        if (rel <= opts.tolerance) return TSolverResult{it, rel, true};
+
+        m(s, sh);
+        a(sh, t);
+        const T tt = t * t;
+        omega = tt == T() ? T() : (t * s) / tt;
+        x.axpy(omega, sh);
+
+        r = s - t * omega;
+        rel = double(norm(r) / bnorm);
+        if (rel <= opts.tolerance) return TSolverResult{it, rel, true};
+        if (omega == T()) return TSolverResult{it, rel, false};
+    }
+    return TSolverResult{opts.max_iterations, rel, false};
+}
+
+template<typename T, typename Op>
+TSolverResult bicgstab(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x,
+                       const TSolverOptions& opts = TSolverOptions())
+{
+    return bicgstab(a, b, x, TIdentityPreconditioner(), opts);
+}
+
+// Restarted GMRES(opts.restart) with right preconditioning, so the residual it
+// minimizes and reports is the true one. The Krylov basis is restart + 1 vectors
+// of length n, allocated up front; the Hessenberg matrix is reduced by Givens rotations as it
+// grows, which gives the residual norm of every step without forming x.
+// iterations counts inner steps over all restarts.
+template<typename T, typename Op, typename Pre>
+TSolverResult gmres(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x, const Pre& m,
+                    const TSolverOptions& opts = TSolverOptions())
+{
+    using namespace tsolvers_detail;
+    check_system(b, x);
+    if (opts.restart == 0) throw out_of_range("GMRES restart length must be greater than 0");
+
+    const size_t n = b.length(), k = opts.restart;
+    std::vector<TDynamicVector<T>> v;
+    v.reserve(k + 1);
+    for (size_t i = 0; i <= k; ++i) v.emplace_back(n, uninitialized);
+    TDynamicVector<T> r(n, uninitialized), w(n, uninitialized), z(n, uninitialized);
+    TDynamicVector<T> h(tmemory::checked_mul(k + 1, k)), cs(k, uninitialized), sn(k, uninitialized), g(k + 1), y(k, uninitialized);
+    const T bnorm = norm(b);
+    if (bnorm == T())
+    {
+        std::fill(x.data(), x.data() + n, T());
+        return TSolverResult{0, 0, true};
+    }
+
+    size_t it = 0;
+    double rel = 0;
+    while (true)
+    {
+        residual(a, b, x, r);
+        const T beta = norm(r);
+        rel = double(beta / bnorm);
+        if (rel <= opts.tolerance) return TSolverResult{it, rel, true};
+        if (it >= opts.max_iterations) return TSolverResult{it, rel, false};
+
+        v[0] = r * (T(1) / beta);
+        std::fill(g.data(), g.data() + k + 1, T());
+        g[0] = beta;
+
+        // Arnoldi with modified Gram-Schmidt; column j of H is h[i * k + j].
+        size_t j = 0;
+        while (j < k && it < opts.max_iterations)
+        {
+            m(v[j], z);
+            a(z, w);
+            for (size_t i = 0; i <= j; ++i)
+            {
+                h[i * k + j] = w * v[i];
+                w.axpy(-h[i * k + j], v[i]);
+            }
+            const T hNext = norm(w);
+            h[(j + 1) * k + j] = hNext;
+
+            for (size_t i = 0; i < j; ++i)
+            {
+                const T hi = h[i * k + j], hi1 = h[(i + 1) * k + j];
+                h[i * k + j] = cs[i] * hi + sn[i] * hi1;
+                h[(i + 1) * k + j] = -sn[i] * hi + cs[i] * hi1;
+            }
+            const T hj = h[j * k + j];
+            const T rho = std::sqrt(hj * hj + hNext * hNext);
+            cs[j] = rho == T() ? T(1) : hj / rho;
+            sn[j] = rho == T() ? T() : hNext / rho;
+            h[j * k + j] = rho;
+            h[(j + 1) * k + j] = T();
+            g[j + 1] = -sn[j] * g[j];
+            g[j] = cs[j] * g[j];
+
+            ++j;
+            ++it;
+            rel = double(std::abs(g[j]) / bnorm);
+            if (rel <= opts.tolerance || hNext == T()) break;
+            v[j] = w * (T(1) / hNext);
+        }
+
+        // x += M^-1 V y with H y = g.
+        for (size_t i = j; i-- > 0;)
+        {
+            T s = g[i];
+            for (size_t l = i + 1; l < j; ++l) s -= h[i * k + l] * y[l];
+            y[i] = h[i * k + i] == T() ? T() : s / h[i * k + i];
+        }
+        r = v[0] * y[0];
+        for (size_t i = 1; i < j; ++i) r.axpy(y[i], v[i]);
+        m(r, z);
+        x += z;
+    }
+}
+
+template<typename T, typename Op>
+TSolverResult gmres(const Op& a, const TDynamicVector<T>& b, TDynamicVector<T>& x,
+                    const TSolverOptions& opts = TSolverOptions())
+{
+    return gmres(a, b, x, TIdentityPreconditioner(), opts);
+}
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef __TSparseMatrix_H__
+#define __TSparseMatrix_H__
+
+#include <vector>
+#include <utility>
+#include "tmatrix.h"
+
+// Sparse matrices whose memory and arithmetic scale with the number of stored
+// elements (nnz) instead of rows * cols:
+//
+//   TCooMatrix - unordered (row, col, value) triplets, for building a matrix;
+//   TCsrMatrix - compressed sparse rows, for products and row access;
+//   TCscMatrix - compressed sparse columns, for column access.
+//
+// Compressed formats keep the indices of every row (column) sorted and free of
+// duplicates; duplicates added to a TCooMatrix are summed on conversion.
+
+namespace tsparse_detail
+{
+
+inline void check_shape(size_t rows, size_t cols)
+{
+    if (rows == 0 || cols == 0)
+        throw out_of_range("Matrix size must be greater than 0");
+    if (rows > MAX_VECTOR_LEN || cols > MAX_VECTOR_LEN)
+        throw out_of_range("Matrix size exceeds maximum limit");
+}
+
+// Builds a compressed layout over nOuter rows (or columns) from triplets given as
+// (outer, inner, value) arrays: ptr[o]..ptr[o + 1] delimits the sorted inner indices
+// of o, and duplicate (outer, inner) pairs are summed.
+template<typename T>
+void compress(size_t nOuter, size_t n, const size_t* outer, const size_t* inner, const T* vals,
+              std::pmr::vector<size_t>& ptr, std::pmr::vector<size_t>& ind, std::pmr::vector<T>& out)
+{
+    ptr.assign(nOuter + 1, 0);
+    for (size_t k = 0; k < n; ++k) ++ptr[outer[k] + 1];
+    for (size_t o = 0; o < nOuter; ++o) ptr[o + 1] += ptr[o];
+
+    std::vector<std::pair<size_t, T>> sorted(n);
+    std::vector<size_t> next(ptr.begin(), ptr.end() - 1);
+    for (size_t k = 0; k < n; ++k)
+        sorted[next[outer[k]]++] = std::make_pair(inner[k], vals[k]);
+
+    ind.clear();
+    out.clear();
+    ind.reserve(n);
+    out.reserve(n);
+    size_t begin = 0;
+    for (size_t o = 0; o < nOuter; ++o)
+    {
+        const size_t end = ptr[o + 1];
+        std::stable_sort(sorted.begin() + begin, sorted.begin() + end,
+                         [](const std::pair<size_t, T>& a, const std::pair<size_t, T>& b) { return a.first < b.first; });
+
+        ptr[o] = ind.size();
+        for (size_t k = begin; k < end; ++k)
+        {
+            if (ind.size() > ptr[o] && ind.back() == sorted[k].first)
+                out.back() += sorted[k].second;
+            else
+            {
+                ind.push_back(sorted[k].first);
+                out.push_back(sorted[k].second);
+            }
+        }
+        begin = end;
+    }
+    ptr[nOuter] = ind.size();
+}
+
+// Converts a compressed layout to the other orientation (CSR <-> CSC). Scanning the
+// outer dimension in order leaves the new inner indices sorted.
+template<typename T>
+void transpose(size_t nOuter, size_t nInner,
+               const std::pmr::vector<size_t>& ptr, const std::pmr::vector<size_t>& ind, const std::pmr::vector<T>& val,
+               std::pmr::vector<size_t>& tPtr, std::pmr::vector<size_t>& tInd, std::pmr::vector<T>& tVal)
+{
+    tPtr.assign(nInner + 1, 0);
+    for (size_t k = 0; k < ind.size(); ++k) ++tPtr[ind[k] + 1];
+    for (size_t i = 0; i < nInner; ++i) tPtr[i + 1] += tPtr[i];
+
+    tInd.resize(ind.size());
+    tVal.resize(ind.size());
+    std::vector<size_t> next(tPtr.begin(), tPtr.end() - 1);
+    for (size_t o = 0; o < nOuter; ++o)
+        for (size_t k = ptr[o]; k < ptr[o + 1]; ++k)
+        {
+            const size_t p = next[ind[k]]++;
+            tInd[p] = o;
+            tVal[p] = val[k];
+        }
+}
+
+// Value at inner index j of the sorted segment [begin, end), or zero.
+template<typename T>
+T find(const std::pmr::vector<size_t>& ind, const std::pmr::vector<T>& val, size_t begin, size_t end, size_t j)
+{
+    const auto first = ind.begin() + begin, last = ind.begin() + end;
+    const auto it = std::lower_bound(first, last, j);
+    return it != last && *it == j ? val[it - ind.begin()] : T();
+}
+
+}
+
+template<typename T>
+class TCscMatrix;
+
+template<typename T>
+class TCooMatrix
+{
+protected:
+    size_t nRows;
+    size_t nCols;
+    std::pmr::vector<size_t> rowInd;
+    std::pmr::vector<size_t> colInd;
+    std::pmr::vector<T> values;
+
+public:
+    typedef T value_type;
+
+    TCooMatrix(size_t rows, size_t cols, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(rows), nCols(cols), rowInd(res), colInd(res), values(res)
+    {
+        tsparse_detail::check_shape(rows, cols);
+    }
+
+    void reserve(size_t n)
+    {
+        rowInd.reserve(n);
+        colInd.reserve(n);
+        values.reserve(n);
+    }
+
+    // Adds v at (i, j); several entries at the same position are summed.
+    void add(size_t i, size_t j, const T& v)
+    {
+        if (i >= nRows || j >= nCols) throw out_of_range("Matrix index out of range");
+        rowInd.push_back(i);
+        colInd.push_back(j);
+        values.push_back(v);
+    }
+
+    void clear() noexcept
+    {
+        rowInd.clear();
+        colInd.clear();
+        values.clear();
+    }
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    // Number of entries added, duplicates included.
+    size_t nnz() const noexcept { return values.size(); }
+
+    const size_t* row_indices() const noexcept { return rowInd.data(); }
+
+    const size_t* col_indices() const noexcept { return colInd.data(); }
+
+    const T* data() const noexcept { return values.data(); }
+};
+
+template<typename T>
+class TCsrMatrix
+{
+protected:
+    size_t nRows;
+    size_t nCols;
+    std::pmr::vector<size_t> rowPtr;
+    std::pmr::vector<size_t> colInd;
+    std::pmr::vector<T> values;
+
+    template<typename U> friend class TCscMatrix;
+
+    // Rows per parallel chunk, so that a chunk holds about PARALLEL_GRAIN elements.
+    size_t row_grain() const noexcept
+    {
+        return std::max<size_t>(1, PARALLEL_GRAIN / std::max<size_t>(1, nnz() / nRows));
+    }
+
+public:
+    typedef T value_type;
+
+    TCsrMatrix(size_t rows, size_t cols, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(rows), nCols(cols), rowPtr(res), colInd(res), values(res)
+    {
+        tsparse_detail::check_shape(rows, cols);
+        rowPtr.assign(nRows + 1, 0);
+    }
+
+    explicit TCsrMatrix(const TCooMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.rows()), nCols(m.cols()), rowPtr(res), colInd(res), values(res)
+    {
+        tsparse_detail::compress(nRows, m.nnz(), m.row_indices(), m.col_indices(), m.data(),
+                                 rowPtr, colInd, values);
+    }
+
+    // Keeps the nonzero elements of m.
+    explicit TCsrMatrix(const TDynamicMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.rows()), nCols(m.cols()), rowPtr(res), colInd(res), values(res)
+    {
+        rowPtr.reserve(nRows + 1);
+        rowPtr.push_back(0);
+        for (size_t i = 0; i < nRows; ++i)
+        {
+            const T* row = m.row_data(i);
+            for (size_t j = 0; j < nCols; ++j)
+                if (row[j] != T())
+                {
+                    colInd.push_back(j);
+                    values.push_back(row[j]);
+                }
+            rowPtr.push_back(colInd.size());
+        }
+    }
+
+    explicit TCsrMatrix(const TCscMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.rows()), nCols(m.cols()), rowPtr(res), colInd(res), values(res)
+    {
+        tsparse_detail::transpose(nCols, nRows, m.colPtr, m.rowInd, m.values, rowPtr, colInd, values);
+    }
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    size_t nnz() const noexcept { return values.size(); }
+
+    // Stored elements of row i are row_ptr()[i]..row_ptr()[i + 1] of col_indices() and data().
+    const size_t* row_ptr() const noexcept { return rowPtr.data(); }
+
+    const size_t* col_indices() const noexcept { return colInd.data(); }
+
+    T* data() noexcept { return values.data(); }
+
+    const T* data() const noexcept { return values.data(); }
+
+    // Element (i, j), zero if it is not stored; a binary search in row i.
+    T operator()(size_t i, size_t j) const
+    {
+        if (i >= nRows || j >= nCols) throw out_of_range("Matrix index out of range");
+        return tsparse_detail::find(colInd, values, rowPtr[i], rowPtr[i + 1], j);
+    }
+
+    TDynamicMatrix<T> to_dense() const
+    {
+        TDynamicMatrix<T> res(nRows, nCols);
+        for (size_t i = 0; i < nRows; ++i)
+            for (size_t k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+                res(i, colInd[k]) = values[k];
+        return res;
+    }
+
+    // y = A * x; rows are independent and split across matrix_executor().
+    TDynamicVector<T> multiply(const TDynamicVector<T>& x) const
+    {
+        TDynamicVector<T> res(nRows, uninitialized);
+        multiply(x, res);
+        return res;
+    }
+
+    // res = A * x into a vector of rows() elements, without allocating.
+    void multiply(const TDynamicVector<T>& x, TDynamicVector<T>& res) const
+    {
+        if (x.length() != nCols || res.length() != nRows)
+            throw length_error("Vector and Matrix dimensions incompatible");
+
+        run_ranges(nRows, row_grain(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                T sum = T();
+                for (size_t k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+                    sum += values[k] * x[colInd[k]];
+                res[i] = sum;
+            }
+        });
+    }
+
+    // C = A * B by Gustavson's row-by-row algorithm: a symbolic pass counts the
+    // elements of every row of C, a numeric pass fills them. Each pass runs over
+    // row chunks in parallel with its own column markers.
+    TCsrMatrix multiply(const TCsrMatrix& m) const
+    {
+        if (m.nRows != nCols) throw length_error("Matrix dimensions mismatch for multiplication");
+
+        TCsrMatrix res(nRows, m.nCols);
+        const size_t grain = std::max<size_t>(64, nRows / (4 * matrix_executor().concurrency()));
+        const size_t unmarked = SIZE_MAX;
+
+        run_ranges(nRows, grain, [&](size_t begin, size_t end)
+        {
+            std::vector<size_t> mark(m.nCols, unmarked);
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t count = 0;
+                for (size_t k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+                {
+                    const size_t r = colInd[k];
+                    for (size_t kk = m.rowPtr[r]; kk < m.rowPtr[r + 1]; ++kk)
+                        if (mark[m.colInd[kk]] != i)
+                        {
+                            mark[m.colInd[kk]] = i;
+                            ++count;
+                        }
+                }
+                res.rowPtr[i + 1] = count;
+            }
+        });
+        for (size_t i = 0; i < nRows; ++i) res.rowPtr[i + 1] += res.rowPtr[i];
+        res.colInd.resize(res.rowPtr[nRows]);
+        res.values.resize(res.rowPtr[nRows]);
+
+        run_ranges(nRows, grain, [&](size_t begin, size_t end)
+        {
+            std::vector<size_t> mark(m.nCols, unmarked);
+            std::vector<T> acc(m.nCols);
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t* cols = res.colInd.data() + res.rowPtr[i];
+                size_t count = 0;
+                for (size_t k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+                {
+                    const size_t r = colInd[k];
+                    const T a = values[k];
+                    for (size_t kk = m.rowPtr[r]; kk < m.rowPtr[r + 1]; ++kk)
+                    {
+                        const size_t j = m.colInd[kk];
+                        if (mark[j] != i)
+                        {
+                            mark[j] = i;
+                            acc[j] = a * m.values[kk];
+                            cols[count++] = j;
+                        }
+                        else
+                            acc[j] += a * m.values[kk];
+                    }
+                }
+                std::sort(cols, cols + count);
+                T* vals = res.values.data() + res.rowPtr[i];
+                for (size_t p = 0; p < count; ++p) vals[p] = acc[cols[p]];
+            }
+        });
+        return res;
+    }
+};
+
+template<typename T>
+class TCscMatrix
+{
+protected:
+    size_t nRows;
+    size_t nCols;
+    std::pmr::vector<size_t> colPtr;
+    std::pmr::vector<size_t> rowInd;
+    std::pmr::vector<T> values;
+
+    template<typename U> friend class TCsrMatrix;
+
+public:
+    typedef T value_type;
+
+    TCscMatrix(size_t rows, size_t cols, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(rows), nCols(cols), colPtr(res), rowInd(res), values(res)
+    {
+        tsparse_detail::check_shape(rows, cols);
+        colPtr.assign(nCols + 1, 0);
+    }
+
+    explicit TCscMatrix(const TCooMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.rows()), nCols(m.cols()), colPtr(res), rowInd(res), values(res)
+    {
+        tsparse_detail::compress(nCols, m.nnz(), m.col_indices(), m.row_indices(), m.data(),
+                                 colPtr, rowInd, values);
+    }
+
+    // Keeps the nonzero elements of m.
+    explicit TCscMatrix(const TDynamicMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TCscMatrix(TCsrMatrix<T>(m), res) {}
+
+    explicit TCscMatrix(const TCsrMatrix<T>& m, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : nRows(m.rows()), nCols(m.cols()), colPtr(res), rowInd(res), values(res)
+    {
+        tsparse_detail::transpose(nRows, nCols, m.rowPtr, m.colInd, m.values, colPtr, rowInd, values);
+    }
+
+    size_t rows() const noexcept { return nRows; }
+
+    size_t cols() const noexcept { return nCols; }
+
+    size_t nnz() const noexcept { return values.size(); }
+
+    // Stored elements of column j are col_ptr()[j]..col_ptr()[j + 1] of row_indices() and data().
+    const size_t* col_ptr() const noexcept { return colPtr.data(); }
+
+    const size_t* row_indices() const noexcept { return rowInd.data(); }
+
+    T* data() noexcept { return values.data(); }
+
+    const T* data() const noexcept { return values.data(); }
+
+    // Element (i, j), zero if it is not stored; a binary search in column j.
+    T operator()(size_t i, size_t j) const
+    {
+        if (i >= nRows || j >= nCols) throw out_of_range("Matrix index out of range");
+        return tsparse_detail::find(rowInd, values, colPtr[j], colPtr[j + 1], i);
+    }
+
+    TDynamicMatrix<T> to_dense() const
+    {
+        TDynamicMatrix<T> res(nRows, nCols);
+        for (size_t j = 0; j < nCols; ++j)
+            for (size_t k = colPtr[j]; k < colPtr[j + 1]; ++k)
+                res(rowInd[k], j) = values[k];
+        return res;
+    }
+
+    // y = A * x, scattering column j scaled by x[j]. Columns write to shared rows,
+    // so this runs on the calling thread; convert to CSR for a parallel product.
+    TDynamicVector<T> multiply(const TDynamicVector<T>& x) const
+    {
+        TDynamicVector<T> res(nRows, uninitialized);
+        multiply(x, res);
+        return res;
+    }
+
+    // res = A * x into a vector of rows() elements, without allocating.
+    void multiply(const TDynamicVector<T>& x, TDynamicVector<T>& res) const
+    {
+        if (x.length() != nCols || res.length() != nRows)
+            throw length_error("Vector and Matrix dimensions incompatible");
+
+        std::fill(res.data(), res.data() + nRows, T());
+        for (size_t j = 0; j < nCols; ++j)
+        {
+            const T xj = x[j];
+            for (size_t k = colPtr[j]; k < colPtr[j + 1]; ++k)
+                res[rowInd[k]] += values[k] * xj;
+        }
+    }
+};
+
+template<typename T, typename E>
+TDynamicVector<T> operator*(const TCsrMatrix<T>& m, const TVectorExpr<E>& x)
+{
+    return m.multiply(materialize(x.self()));
+}
+
+template<typename T, typename E>
+TDynamicVector<T> operator*(const TCscMatrix<T>& m, const TVectorExpr<E>& x)
+{
+    return m.multiply(materialize(x.self()));
+}
+
+template<typename T>
+TCsrMatrix<T> operator*(const TCsrMatrix<T>& l, const TCsrMatrix<T>& r)
+{
+    return l.multiply(r);
+}
+
+#endif
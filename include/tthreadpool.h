@@ -0,0 +1,366 @@
+#ifndef __TThreadPool_H__
+#define __TThreadPool_H__
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Non-owning reference to a callable task(i). Executors take it instead of a
+// std::function, which would allocate for any lambda capturing more than a couple
+// of references; the callable only has to outlive the parallel_for call.
+class TIndexTask
+{
+    const void* callable;
+    void (*invoke)(const void*, size_t);
+
+    template<typename F>
+    static void call(const void* f, size_t i)
+    {
+        (*static_cast<const F*>(f))(i);
+    }
+
+public:
+    template<typename F>
+    TIndexTask(const F& f) : callable(&f), invoke(&call<F>) {}
+
+    void operator()(size_t i) const { invoke(callable, i); }
+};
+
+// Runs a batch of independent tasks; parallel_for returns once all of them are done
+// and rethrows the first exception thrown by a task.
+class TExecutor
+{
+public:
+    virtual ~TExecutor() {}
+
+    virtual size_t concurrency() const noexcept = 0;
+
+    virtual void parallel_for(size_t n, TIndexTask task) = 0;
+};
+
+class TSerialExecutor : public TExecutor
+{
+public:
+    size_t concurrency() const noexcept override { return 1; }
+
+    void parallel_for(size_t n, TIndexTask task) override
+    {
+        for (size_t i = 0; i < n; ++i) task(i);
+    }
+};
+
+// Persistent pool of nThreads - 1 workers plus the calling thread. Every worker owns
+// a queue: it pops its own tasks LIFO and steals from the others FIFO. A thread
+// waiting in parallel_for keeps executing queued tasks, so nested calls from
+// inside a task cannot deadlock.
+//
+// A queued task is a pointer to its batch, which lives on the stack of the
+// parallel_for call, plus an index, and the queues are rings that only grow, so
+// once the pool has run a batch of some size it dispatches batches up to that
+// size without allocating.
+class TThreadPool : public TExecutor
+{
+    struct TBatch
+    {
+        TIndexTask task;
+        std::atomic<size_t> remaining;
+        std::mutex m;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        TBatch(TIndexTask _task, size_t n) : task(_task), remaining(n) {}
+
+        void run(size_t i)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (!error) error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(m);
+            if (--remaining == 0) done.notify_all();
+        }
+    };
+
+    struct TQueuedTask
+    {
+        TBatch* batch;
+        size_t index;
+    };
+
+    struct TWorkQueue
+    {
+        std::mutex m;
+        std::vector<TQueuedTask> ring;
+        size_t head, count;
+
+        TWorkQueue() : ring(64), head(0), count(0) {}
+
+        void push_back(const TQueuedTask& t)
+        {
+            if (count == ring.size())
+            {
+                std::vector<TQueuedTask> bigger(2 * ring.size());
+                for (size_t i = 0; i < count; ++i) bigger[i] = ring[(head + i) % ring.size()];
+                ring.swap(bigger);
+                head = 0;
+            }
+            ring[(head + count) % ring.size()] = t;
+            ++count;
+        }
+
+        TQueuedTask pop_back()
+        {
+            --count;
+            return ring[(head + count) % ring.size()];
+        }
+
+        TQueuedTask pop_front()
+        {
+            const TQueuedTask t = ring[head];
+            head = (head + 1) % ring.size();
+            --count;
+            return t;
+        }
+    };
+
+    size_t nThreads;
+    std::vector<std::unique_ptr<TWorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending;
+    std::atomic<size_t> nextQueue;
+    std::mutex waitMutex;
+    std::condition_variable wakeUp;
+    bool stop;
+
+    static const TThreadPool*& current_pool() noexcept
+    {
+        static thread_local const TThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& current_index() noexcept
+    {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    bool is_own_worker() const noexcept { return current_pool() == this; }
+
+    void push(const TQueuedTask& task)
+    {
+        const size_t q = is_own_worker() ? current_index() : nextQueue++ % queues.size();
+        ++pending;
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->m);
+            queues[q]->push_back(task);
+        }
+        std::lock_guard<std::mutex> lock(waitMutex);
+        wakeUp.notify_one();
+    }
+
+    bool try_pop(size_t q, bool back, TQueuedTask& task)
+    {
+        std::lock_guard<std::mutex> lock(queues[q]->m);
+        TWorkQueue& queue = *queues[q];
+        if (queue.count == 0) return false;
+        task = back ? queue.pop_back() : queue.pop_front();
+        --pending;
+        return true;
+    }
+
+    bool try_run_one()
+    {
+        TQueuedTask task;
+        const bool own = is_own_worker();
+        const size_t start = own ? current_index() : nextQueue.load() % queues.size();
+        if (own && try_pop(start, true, task))
+        {
+            task.batch->run(task.index);
+            return true;
+        }
+        for (size_t i = own ? 1 : 0; i < queues.size(); ++i)
+        {
+            if (try_pop((start + i) % queues.size(), false, task))
+            {
+                task.batch->run(task.index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index)
+    {
+        current_pool() = this;
+        current_index() = index;
+        while (true)
+        {
+            if (try_run_one()) continue;
+
+            std::unique_lock<std::mutex> lock(waitMutex);
+            wakeUp.wait(lock, [this] { return stop || pending > 0; });
+            if (stop && pending == 0) return;
+        }
+    }
+
+public:
+    explicit TThreadPool(size_t _nThreads = std::thread::hardware_concurrency())
+        : nThreads(_nThreads == 0 ? 1 : _nThreads), pending(0), nextQueue(0), stop(false)
+    {
+        const size_t nWorkers = nThreads - 1;
+        for (size_t i = 0; i < (nWorkers == 0 ? 1 : nWorkers); ++i)
+            queues.emplace_back(new TWorkQueue);
+        for (size_t i = 0; i < nWorkers; ++i)
+            workers.emplace_back(&TThreadPool::worker_loop, this, i);
+    }
+
+    TThreadPool(const TThreadPool&) = delete;
+    TThreadPool& operator=(const TThreadPool&) = delete;
+
+    ~TThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            stop = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    size_t concurrency() const noexcept override { return nThreads; }
+
+    void parallel_for(size_t n, TIndexTask task) override
+    {
+        if (n == 0) return;
+        if (n == 1 || workers.empty())
+        {
+            for (size_t i = 0; i < n; ++i) task(i);
+            return;
+        }
+
+        TBatch batch(task, n);
+        for (size_t i = 1; i < n; ++i)
+            push(TQueuedTask{&batch, i});
+        batch.run(0);
+
+        while (batch.remaining > 0)
+        {
+            if (try_run_one()) continue;
+            std::unique_lock<std::mutex> lock(batch.m);
+            batch.done.wait_for(lock, std::chrono::microseconds(200),
+                                [&batch] { return batch.remaining == 0; });
+        }
+
+        // The last task may still hold the lock while notifying.
+        std::lock_guard<std::mutex> lock(batch.m);
+        if (batch.error) std::rethrow_exception(batch.error);
+    }
+};
+
+// Splits [0, n) into at most ex.concurrency() chunks of at least grain indices
+// and runs f(begin, end) on each of them.
+template<typename F>
+void parallel_ranges(TExecutor& ex, size_t n, size_t grain, const F& f)
+{
+    const size_t maxChunks = (n + grain - 1) / (grain == 0 ? 1 : grain);
+    const size_t nChunks = maxChunks < ex.concurrency() ? maxChunks : ex.concurrency();
+    if (nChunks <= 1)
+    {
+        f(size_t(0), n);
+        return;
+    }
+
+    const size_t chunk = (n + nChunks - 1) / nChunks;
+    ex.parallel_for(nChunks, [&](size_t c)
+    {
+        const size_t begin = c * chunk;
+        f(begin, begin + chunk < n ? begin + chunk : n);
+    });
+}
+
+namespace tthreadpool_detail
+{
+
+inline std::mutex& config_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+inline std::unique_ptr<TThreadPool>& default_pool()
+{
+    static std::unique_ptr<TThreadPool> pool;
+    return pool;
+}
+
+inline TExecutor*& custom_executor()
+{
+    static TExecutor* executor = nullptr;
+    return executor;
+}
+
+// The executor matrix_executor() returns, null until the default pool is created.
+// Written under config_mutex, read without it.
+inline std::atomic<TExecutor*>& active_executor()
+{
+    static std::atomic<TExecutor*> executor(nullptr);
+    return executor;
+}
+
+// Called with config_mutex held after either setting changes.
+inline void publish_executor()
+{
+    TExecutor* executor = custom_executor();
+    if (!executor) executor = default_pool().get();
+    active_executor().store(executor, std::memory_order_release);
+}
+
+}
+
+// Executor used by the matrix operators. Not meant to be reconfigured while
+// matrix operations are running on other threads. Once configured this is a
+// single atomic load; the mutex is only taken to create the default pool.
+inline TExecutor& matrix_executor()
+{
+    TExecutor* executor = tthreadpool_detail::active_executor().load(std::memory_order_acquire);
+    if (executor) return *executor;
+
+    std::lock_guard<std::mutex> lock(tthreadpool_detail::config_mutex());
+    std::unique_ptr<TThreadPool>& pool = tthreadpool_detail::default_pool();
+    if (!tthreadpool_detail::custom_executor() && !pool)
+    {
+        pool.reset(new TThreadPool());
+        tthreadpool_detail::publish_executor();
+    }
+    return *tthreadpool_detail::active_executor().load(std::memory_order_relaxed);
+}
+
+inline void set_matrix_threads(size_t nThreads)
+{
+    std::lock_guard<std::mutex> lock(tthreadpool_detail::config_mutex());
+    // The old pool is destroyed only after the new one is published.
+    std::unique_ptr<TThreadPool> old(new TThreadPool(nThreads));
+    tthreadpool_detail::default_pool().swap(old);
+    tthreadpool_detail::publish_executor();
+}
+
+// Routes matrix operators through a user-owned executor; nullptr restores the pool.
+inline void set_matrix_executor(TExecutor* executor)
+{
+    std::lock_guard<std::mutex> lock(tthreadpool_detail::config_mutex());
+    tthreadpool_detail::custom_executor() = executor;
+    tthreadpool_detail::publish_executor();
+}
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef __TUpperTriangularMatrix_H__
+#define __TUpperTriangularMatrix_H__
+
+#include "tmatrix.h"
+
+// An upper-triangular size x size matrix in packed row-major storage: only the
+// size * (size + 1) / 2 elements on and above the diagonal are kept, row i holding
+// columns i..size-1. The kernels never touch the zero half.
+//
+// It is also a matrix expression, so it can be assigned to or combined with dense
+// matrices; operations between two triangular matrices stay packed.
+template<typename T>
+class TUpperTriangularMatrix : public TMatrixExpr<TUpperTriangularMatrix<T>>
+{
+protected:
+    size_t size;
+    T* pData;
+    std::pmr::memory_resource* pRes;
+
+    static void check_size(size_t s)
+    {
+        if (s == 0)
+            throw out_of_range("Matrix size must be greater than 0");
+        if (s > MAX_MATRIX_LEN)
+            throw out_of_range("Matrix size exceeds maximum limit");
+    }
+
+    static size_t packed_length(size_t s)
+    {
+        return tmemory::checked_mul(s, s + 1) / 2;
+    }
+
+    // Start of row i, i.e. of element (i, i).
+    size_t offset(size_t i) const noexcept
+    {
+        return i * size - i * (i - 1) / 2;
+    }
+
+    // Rows hold less work the further down they are, so they are not split evenly:
+    // work_before(i) is the work in rows [0, i), nondecreasing, and the ranges cut
+    // it into equal shares of at least PARALLEL_GRAIN.
+    template<typename W, typename F>
+    void for_each_row_range(const W& work_before, const F& f) const
+    {
+        const double total = work_before(size);
+        TExecutor& ex = matrix_executor();
+        const size_t nChunks = std::min<size_t>(ex.concurrency(), size_t(total / PARALLEL_GRAIN));
+        if (nChunks <= 1)
+        {
+            f(size_t(0), size);
+            return;
+        }
+
+        std::vector<size_t> bounds(nChunks + 1, size);
+        bounds[0] = 0;
+        for (size_t c = 1; c < nChunks; ++c)
+        {
+            // Smallest i with work_before(i) >= c / nChunks of the total.
+            const double share = total * double(c) / double(nChunks);
+            size_t lo = bounds[c - 1], hi = size;
+            while (lo < hi)
+            {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (work_before(mid) < share) lo = mid + 1;
+                else hi = mid;
+            }
+            bounds[c] = lo;
+        }
+        ex.parallel_for(nChunks, [&](size_t c)
+        {
+            if (bounds[c] < bounds[c + 1]) f(bounds[c], bounds[c + 1]);
+        });
+    }
+
+    // Stored elements in rows [0, i), the triangular-number offset of row i.
+    double stored_before(size_t i) const noexcept
+    {
+        return double(i) * double(size) - double(i) * (double(i) - 1) / 2;
+    }
+
+public:
+    typedef T value_type;
+
+    TUpperTriangularMatrix(size_t s = 1, std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(s), pRes(res)
+    {
+        check_size(s);
+        pData = tmemory::create<T>(pRes, packed_length(size));
+    }
+
+    TUpperTriangularMatrix(size_t s, TUninitialized,
+                           std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(s), pRes(res)
+    {
+        check_size(s);
+        pData = tmemory::create_uninitialized<T>(pRes, packed_length(size));
+    }
+
+    // Takes the upper triangle of a square matrix; the rest is ignored.
+    explicit TUpperTriangularMatrix(const TDynamicMatrix<T>& m,
+                                    std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : TUpperTriangularMatrix(m.rows(), uninitialized, res)
+    {
+        if (!m.is_square()) throw length_error("Triangular matrix must be square");
+        for (size_t i = 0; i < size; ++i)
+            std::copy(m.row_data(i) + i, m.row_data(i) + size, row_data(i));
+    }
+
+    TUpperTriangularMatrix(const TUpperTriangularMatrix& m,
+                           std::pmr::memory_resource* res = std::pmr::get_default_resource())
+        : size(m.size), pRes(res)
+    {
+        pData = tmemory::create_copy(pRes, m.pData, packed_length(size));
+    }
+
+    TUpperTriangularMatrix(TUpperTriangularMatrix&& m) noexcept : size(0), pData(nullptr), pRes(m.pRes)
+    {
+        swap(*this, m);
+    }
+
+    ~TUpperTriangularMatrix()
+    {
+        tmemory::destroy(pRes, pData, packed_length(size));
+        pData = nullptr;
+    }
+
+    TUpperTriangularMatrix& operator=(const TUpperTriangularMatrix& m)
+    {
+        if (this == &m) return *this;
+
+        if (size != m.size)
+        {
+            T* newData = tmemory::create_copy(pRes, m.pData, packed_length(m.size));
+            tmemory::destroy(pRes, pData, packed_length(size));
+            pData = newData;
+            size = m.size;
+        }
+        else
+            std::copy(m.pData, m.pData + packed_length(size), pData);
+
+        return *this;
+    }
+
+    TUpperTriangularMatrix& operator=(TUpperTriangularMatrix&& m)
+    {
+        if (this == &m) return *this;
+        if (pRes != m.pRes && !(*pRes == *m.pRes)) return *this = m;
+
+        tmemory::destroy(pRes, pData, packed_length(size));
+        pData = nullptr;
+        size = 0;
+        swap(*this, m);
+
+        return *this;
+    }
+
+    TUpperTriangularMatrix& operator+=(const TUpperTriangularMatrix& m)
+    {
+        if (m.size != size) throw length_error("Matrix dimensions mismatch");
+        tsimd::add(packed_length(size), pData, m.pData, pData);
+        return *this;
+    }
+
+    TUpperTriangularMatrix& operator-=(const TUpperTriangularMatrix& m)
+    {
+        if (m.size != size) throw length_error("Matrix dimensions mismatch");
+        tsimd::sub(packed_length(size), pData, m.pData, pData);
+        return *this;
+    }
+
+    TUpperTriangularMatrix& operator*=(const T& val)
+    {
+        tsimd::scale(packed_length(size), pData, val, pData);
+        return *this;
+    }
+
+    size_t rows() const noexcept { return size; }
+
+    size_t cols() const noexcept { return size; }
+
+    size_t get_size() const noexcept { return size; }
+
+    // Number of stored elements, size * (size + 1) / 2.
+    size_t packed_size() const { return packed_length(size); }
+
+    std::pmr::memory_resource* get_resource() const noexcept { return pRes; }
+
+    T* data() noexcept { return pData; }
+
+    const T* data() const noexcept { return pData; }
+
+    // Elements (i, i)..(i, size - 1), contiguous.
+    T* row_data(size_t i) noexcept { return pData + offset(i); }
+
+    const T* row_data(size_t i) const noexcept { return pData + offset(i); }
+
+    size_t row_length(size_t i) const noexcept { return size - i; }
+
+    // Element access on or above the diagonal.
+    T& operator()(size_t i, size_t j) noexcept
+    {
+        assert(i <= j && "Element below the diagonal is not stored");
+        return pData[offset(i) + (j - i)];
+    }
+
+    T operator()(size_t i, size_t j) const noexcept
+    {
+        return j < i ? T() : pData[offset(i) + (j - i)];
+    }
+
+    T& at(size_t i, size_t j)
+    {
+        if (i >= size || j >= size) throw out_of_range("Matrix index out of range");
+        if (j < i) throw out_of_range("Element below the diagonal is not stored");
+        return pData[offset(i) + (j - i)];
+    }
+
+    void eval_row(size_t i, T* dst) const
+    {
+        std::fill(dst, dst + i, T());
+        std::copy(row_data(i), row_data(i) + row_length(i), dst + i);
+    }
+
+    TDynamicMatrix<T> to_dense() const
+    {
+        return TDynamicMatrix<T>(*this);
+    }
+
+    bool operator==(const TUpperTriangularMatrix& m) const noexcept
+    {
+        return size == m.size && std::equal(pData, pData + packed_length(size), m.pData);
+    }
+
+    bool operator!=(const TUpperTriangularMatrix& m) const noexcept
+    {
+        return !(*this == m);
+    }
+
+    // y[i] = sum over j >= i of (i, j) * x[j]
+    TDynamicVector<T> multiply(const TDynamicVector<T>& x) const
+    {
+        if (x.length() != size) throw length_error("Vector and Matrix dimensions incompatible");
+
+        TDynamicVector<T> res(size, uninitialized);
+        for_each_row_range([&](size_t i) { return stored_before(i); }, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                res[i] = tsimd::dot(row_length(i), row_data(i), x.data() + i);
+        });
+        return res;
+    }
+
+    // The product of upper-triangular matrices is upper-triangular: row i of the
+    // result is the sum over k >= i of (i, k) * row k of m, about size^3 / 6
+    // multiply-adds instead of size^3 for the dense product. Row i costs about
+    // (size - i)^2 / 2 of them, so the rows are split by that cost, whose sum over
+    // rows [0, i) is C(size) - C(size - i) with C(r) = r (r + 1) (r + 2) / 6.
+    TUpperTriangularMatrix multiply(const TUpperTriangularMatrix& m) const
+    {
+        if (m.size != size) throw length_error("Matrix dimensions mismatch for multiplication");
+
+        TUpperTriangularMatrix res(size, uninitialized);
+        auto cubic = [](double r) { return r * (r + 1) * (r + 2) / 6; };
+        const double n = double(size);
+        for_each_row_range([&](size_t i) { return cubic(n) - cubic(n - double(i)); },
+                           [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const T* a = row_data(i);
+                T* c = res.row_data(i);
+                tsimd::scale(row_length(i), m.row_data(i), a[0], c);
+                for (size_t k = i + 1; k < size; ++k)
+                    tsimd::axpy(m.row_length(k), a[k - i], m.row_data(k), c + (k - i));
+            }
+        });
+        return res;
+    }
+
+    friend TUpperTriangularMatrix operator+(const TUpperTriangularMatrix& l, const TUpperTriangularMatrix& r)
+    {
+        if (l.size != r.size) throw length_error("Matrix dimensions mismatch");
+        TUpperTriangularMatrix res(l.size, uninitialized);
+        tsimd::add(l.packed_size(), l.pData, r.pData, res.pData);
+        return res;
+    }
+
+    friend TUpperTriangularMatrix operator-(const TUpperTriangularMatrix& l, const TUpperTriangularMatrix& r)
+    {
+        if (l.size != r.size) throw length_error("Matrix dimensions mismatch");
+        TUpperTriangularMatrix res(l.size, uninitialized);
+        tsimd::sub(l.packed_size(), l.pData, r.pData, res.pData);
+        return res;
+    }
+
+    friend TUpperTriangularMatrix operator*(const TUpperTriangularMatrix& m, const T& val)
+    {
+        TUpperTriangularMatrix res(m.size, uninitialized);
+        tsimd::scale(m.packed_size(), m.pData, val, res.pData);
+        return res;
+    }
+
+    friend TUpperTriangularMatrix operator*(const T& val, const TUpperTriangularMatrix& m)
+    {
+        return m * val;
+    }
+
+    friend TUpperTriangularMatrix operator*(const TUpperTriangularMatrix& l, const TUpperTriangularMatrix& r)
+    {
+        return l.multiply(r);
+    }
+
+    friend TDynamicVector<T> operator*(const TUpperTriangularMatrix& m, const TDynamicVector<T>& x)
+    {
+        return m.multiply(x);
+    }
+
+    friend void swap(TUpperTriangularMatrix& lhs, TUpperTriangularMatrix& rhs) noexcept
+    {
+        std::swap(lhs.size, rhs.size);
+        std::swap(lhs.pData, rhs.pData);
+        std::swap(lhs.pRes, rhs.pRes);
+    }
+
+    // Reads the size - i stored elements of every row i.
+    friend istream& operator>>(istream& istr, TUpperTriangularMatrix& m)
+    {
+        for (size_t i = 0; i < m.packed_size(); ++i) istr >> m.pData[i];
+        return istr;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TUpperTriangularMatrix& m)
+    {
+        for (size_t i = 0; i < m.size; ++i)
+        {
+            for (size_t j = 0; j < m.size; ++j) ostr << m(i, j) << ' ';
+            ostr << endl;
+        }
+        return ostr;
+    }
+};
+
+template<typename T>
+struct TExprOperand<TUpperTriangularMatrix<T>>
+{
+    typedef const TUpperTriangularMatrix<T>& type;
+};
+
+#endif
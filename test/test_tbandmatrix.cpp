@@ -0,0 +1,134 @@
+#include "tbandmatrix.h"
+#include <gtest.h>
+
+static TBandMatrix<int> make_band(size_t n, size_t kl, size_t ku, int seed)
+{
+    TBandMatrix<int> m(n, kl, ku);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            if (j + kl >= i && j <= i + ku)
+                m(i, j) = int((i * 5 + j * 3 + seed) % 9) - 4;
+    return m;
+}
+
+TEST(TBandMatrix, CanCreateBandMatrix)
+{
+    TBandMatrix<int> m(6, 1, 2);
+    EXPECT_EQ(size_t(6), m.rows());
+    EXPECT_EQ(size_t(1), m.lower_bandwidth());
+    EXPECT_EQ(size_t(2), m.upper_bandwidth());
+    EXPECT_EQ(0, m(5, 5));
+}
+
+TEST(TBandMatrix, ThrowsOnInvalidSize)
+{
+    ASSERT_ANY_THROW(TBandMatrix<int> m(0));
+    ASSERT_ANY_THROW(TBandMatrix<int> m(3, 3, 0));
+    ASSERT_ANY_THROW(TBandMatrix<int> m(3, 0, 3));
+}
+
+TEST(TBandMatrix, StoresOnlyTheBand)
+{
+    TBandMatrix<int> m(5, 1, 1);
+    m(2, 3) = 4;
+    m.at(3, 2) = 7;
+    EXPECT_EQ(4, m.diagonal(1)[2]);
+    EXPECT_EQ(7, m.diagonal(-1)[3]);
+
+    const TBandMatrix<int>& c = m;
+    EXPECT_EQ(0, c(0, 4));
+    ASSERT_ANY_THROW(m.at(0, 2));
+    ASSERT_ANY_THROW(m.at(5, 5));
+}
+
+TEST(TBandMatrix, CanConvertToAndFromDense)
+{
+    const TBandMatrix<int> b = make_band(7, 2, 1, 1);
+    TDynamicMatrix<int> d = b.to_dense();
+    for (size_t i = 0; i < 7; i++)
+        for (size_t j = 0; j < 7; j++)
+            EXPECT_EQ(b(i, j), d(i, j));
+
+    d(0, 6) = 9;
+    EXPECT_EQ(b, TBandMatrix<int>(d, 2, 1));
+}
+
+TEST(TBandMatrix, CanAddAndSubtract)
+{
+    TBandMatrix<int> a = make_band(8, 1, 2, 1), b = make_band(8, 1, 2, 4);
+    EXPECT_EQ(TDynamicMatrix<int>(a.to_dense() + b.to_dense()), (a + b).to_dense());
+    EXPECT_EQ(TDynamicMatrix<int>(a.to_dense() - b.to_dense()), (a - b).to_dense());
+    EXPECT_EQ(TDynamicMatrix<int>(a.to_dense() * 2), (2 * a).to_dense());
+    ASSERT_ANY_THROW(a + make_band(8, 2, 2, 0));
+}
+
+TEST(TBandMatrix, MultiplyByVectorMatchesDense)
+{
+    for (size_t n : {1, 5, 64})
+    {
+        TBandMatrix<int> m = make_band(n, n > 3 ? 3 : 0, n > 2 ? 2 : 0, 2);
+        TDynamicVector<int> x(n);
+        for (size_t i = 0; i < n; i++) x[i] = int(i % 4) - 1;
+        EXPECT_EQ(m.to_dense() * x, m * x);
+    }
+    ASSERT_ANY_THROW(make_band(4, 1, 1, 0) * TDynamicVector<int>(3));
+}
+
+TEST(TBandMatrix, LargeMultiplyRunsInParallel)
+{
+    const size_t n = 300000;
+    TBandMatrix<double> m(n, 1, 1);
+    for (size_t i = 0; i < n; i++)
+    {
+        m(i, i) = 2.0;
+        if (i > 0) m(i, i - 1) = -1.0;
+        if (i + 1 < n) m(i, i + 1) = -1.0;
+    }
+    TDynamicVector<double> x(n);
+    for (size_t i = 0; i < n; i++) x[i] = double(i);
+
+    TDynamicVector<double> y = m * x;
+    EXPECT_EQ(-1.0, y[0]);
+    EXPECT_EQ(0.0, y[n / 2]);
+    EXPECT_EQ(double(n), y[n - 1]);
+}
+
+TEST(TBandMatrix, SolvesTridiagonalSystem)
+{
+    const size_t n = 50;
+    TBandMatrix<double> m(n, 1, 1);
+    TDynamicVector<double> x(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        m(i, i) = 4.0;
+        if (i > 0) m(i, i - 1) = -1.0;
+        if (i + 1 < n) m(i, i + 1) = -1.5;
+        x[i] = double(i % 7) - 3.0;
+    }
+
+    TDynamicVector<double> solution = m.solve_tridiagonal(m * x);
+    for (size_t i = 0; i < n; i++)
+        EXPECT_NEAR(x[i], solution[i], 1e-12);
+
+    ASSERT_ANY_THROW(TBandMatrix<double>(5, 2, 1).solve_tridiagonal(TDynamicVector<double>(5)));
+    ASSERT_ANY_THROW(TBandMatrix<double>(5, 1, 1).solve_tridiagonal(TDynamicVector<double>(5)));
+    ASSERT_ANY_THROW(m.solve_tridiagonal(TDynamicVector<double>(n + 1)));
+}
+
+TEST(TBandMatrix, TridiagonalSolveRejectsNumericallySingularMatrix)
+{
+    // Every row sums to zero, but the last pivot rounds to about 2e-16.
+    TBandMatrix<double> m(3, 1, 1);
+    m(0, 0) = 0.1; m(0, 1) = -0.1;
+    m(1, 0) = -1.3; m(1, 1) = 1.3 + 0.1; m(1, 2) = -0.1;
+    m(2, 1) = -0.3; m(2, 2) = 0.3;
+
+    ASSERT_ANY_THROW(m.solve_tridiagonal(TDynamicVector<double>(3)));
+
+    m(2, 2) = 0.4;
+    TDynamicVector<double> x(3);
+    x[0] = 1; x[1] = 2; x[2] = 3;
+    TDynamicVector<double> solution = m.solve_tridiagonal(m * x);
+    for (size_t i = 0; i < 3; i++)
+        EXPECT_NEAR(x[i], solution[i], 1e-12);
+}
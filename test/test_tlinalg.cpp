@@ -0,0 +1,320 @@
+#include "tlinalg.h"
+#include <gtest.h>
+
+// Diagonally weak, so that partial pivoting has to swap rows.
+static TDynamicMatrix<double> test_matrix(size_t n)
+{
+    TDynamicMatrix<double> a(n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            a(i, j) = double((i * 37 + j * 11) % 23) - 11 + (i == j ? 0.5 : 0);
+    return a;
+}
+
+static double max_abs_diff(const TDynamicMatrix<double>& a, const TDynamicMatrix<double>& b)
+{
+    double d = 0;
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < a.cols(); ++j)
+            d = std::max(d, std::abs(a(i, j) - b(i, j)));
+    return d;
+}
+
+TEST(LUDecomposition, SolvesSmallSystem)
+{
+    TDynamicMatrix<double> a(3);
+    a(0, 0) = 0; a(0, 1) = 2; a(0, 2) = 1;
+    a(1, 0) = 1; a(1, 1) = 1; a(1, 2) = 1;
+    a(2, 0) = 4; a(2, 1) = 1; a(2, 2) = 0;
+    TDynamicVector<double> b(3);
+    b[0] = 7; b[1] = 6; b[2] = 6;
+
+    TLUDecomposition<double> lu(a);
+    EXPECT_FALSE(lu.is_singular());
+    TDynamicVector<double> x = lu.solve(b);
+    EXPECT_NEAR(1, x[0], 1e-12);
+    EXPECT_NEAR(2, x[1], 1e-12);
+    EXPECT_NEAR(3, x[2], 1e-12);
+    EXPECT_NEAR(5, lu.determinant(), 1e-12);
+    EXPECT_EQ(2u, lu.pivot_rows()[0]);
+}
+
+TEST(LUDecomposition, FactorsReproducePermutedMatrix)
+{
+    const size_t n = 150;
+    const TDynamicMatrix<double> a = test_matrix(n);
+    TLUDecomposition<double> lu(a);
+
+    TDynamicMatrix<double> l(n), u(n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+        {
+            if (j < i) l(i, j) = lu.factors()(i, j);
+            else u(i, j) = lu.factors()(i, j);
+            if (j == i) l(i, i) = 1;
+        }
+
+    TDynamicMatrix<double> pa(a);
+    for (size_t i = 0; i < n; ++i)
+        if (lu.pivot_rows()[i] != i)
+            std::swap_ranges(pa.row_data(i), pa.row_data(i) + n, pa.row_data(lu.pivot_rows()[i]));
+    EXPECT_LT(max_abs_diff(pa, l * u), 1e-9);
+}
+
+TEST(LUDecomposition, SolvesManyRightHandSides)
+{
+    const size_t n = 130;
+    const TDynamicMatrix<double> a = test_matrix(n);
+    TDynamicMatrix<double> xs(n, 3);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            xs(i, j) = double(i % 7) - double(j);
+
+    TLUDecomposition<double> lu(a);
+    EXPECT_LT(max_abs_diff(xs, lu.solve(a * xs)), 1e-9);
+
+    TDynamicVector<double> x(n);
+    for (size_t i = 0; i < n; ++i) x[i] = double(i) / 10;
+    TDynamicVector<double> y = lu.solve(a * x);
+    for (size_t i = 0; i < n; ++i) EXPECT_NEAR(x[i], y[i], 1e-9);
+}
+
+TEST(LUDecomposition, InverseTimesMatrixIsIdentity)
+{
+    const size_t n = 70;
+    const TDynamicMatrix<double> a = test_matrix(n);
+    TDynamicMatrix<double> identity(n);
+    for (size_t i = 0; i < n; ++i) identity(i, i) = 1;
+    EXPECT_LT(max_abs_diff(identity, a * TLUDecomposition<double>(a).inverse()), 1e-9);
+}
+
+TEST(LUDecomposition, DetectsSingularMatrix)
+{
+    TDynamicMatrix<double> a(80);
+    for (size_t i = 0; i < 80; ++i)
+        for (size_t j = 0; j < 80; ++j)
+            a(i, j) = double(i + j);
+
+    TLUDecomposition<double> lu(a);
+    EXPECT_TRUE(lu.is_singular());
+    EXPECT_EQ(0, lu.determinant());
+    ASSERT_ANY_THROW(lu.solve(TDynamicVector<double>(80)));
+    ASSERT_ANY_THROW(lu.inverse());
+
+    // The threshold is relative to the matrix, so a tiny but well-conditioned
+    // matrix is not singular.
+    TDynamicMatrix<double> small = test_matrix(80);
+    small *= 1e-30;
+    EXPECT_FALSE(TLUDecomposition<double>(small).is_singular());
+}
+
+TEST(LUDecomposition, ChecksDimensions)
+{
+    ASSERT_ANY_THROW(TLUDecomposition<double>(TDynamicMatrix<double>(3, 4)));
+    TLUDecomposition<double> lu(test_matrix(4));
+    ASSERT_ANY_THROW(lu.solve(TDynamicVector<double>(5)));
+    ASSERT_ANY_THROW(lu.solve(TDynamicMatrix<double>(5, 2)));
+}
+
+// B B^T + n I, symmetric positive definite.
+static TDynamicMatrix<double> spd_matrix(size_t n)
+{
+    TDynamicMatrix<double> b(n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            b(i, j) = double((i * 13 + j * 7) % 17) / 17 - 0.5;
+    TDynamicMatrix<double> a = b * TDynamicMatrix<double>(b.t());
+    for (size_t i = 0; i < n; ++i) a(i, i) += double(n);
+    return a;
+}
+
+TEST(CholeskyDecomposition, FactorReproducesMatrix)
+{
+    const size_t n = 150;
+    const TDynamicMatrix<double> a = spd_matrix(n);
+    TCholeskyDecomposition<double> chol(a);
+    const TDynamicMatrix<double> l = chol.lower();
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+            EXPECT_EQ(0, l(i, j));
+    EXPECT_LT(max_abs_diff(a, l * TDynamicMatrix<double>(l.t())), 1e-9);
+}
+
+TEST(CholeskyDecomposition, ReadsOnlyLowerTriangle)
+{
+    const size_t n = 100;
+    const TDynamicMatrix<double> a = spd_matrix(n);
+    TDynamicMatrix<double> garbage(a);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+            garbage(i, j) = -1e6;
+    EXPECT_EQ(TCholeskyDecomposition<double>(a).lower(), TCholeskyDecomposition<double>(garbage).lower());
+}
+
+TEST(CholeskyDecomposition, SolvesAndMatchesLU)
+{
+    const size_t n = 140;
+    const TDynamicMatrix<double> a = spd_matrix(n);
+    TDynamicVector<double> x(n);
+    for (size_t i = 0; i < n; ++i) x[i] = double(i % 9) - 4;
+
+    TCholeskyDecomposition<double> chol(a);
+    TDynamicVector<double> y = chol.solve(a * x);
+    for (size_t i = 0; i < n; ++i) EXPECT_NEAR(x[i], y[i], 1e-9);
+
+    TLUDecomposition<double> lu(a);
+    double logDet = 0;
+    for (size_t i = 0; i < n; ++i) logDet += std::log(std::abs(lu.factors()(i, i)));
+    EXPECT_NEAR(logDet, chol.log_determinant(), 1e-8);
+}
+
+TEST(CholeskyDecomposition, RejectsMatrixThatIsNotPositiveDefinite)
+{
+    TDynamicMatrix<double> a = spd_matrix(90);
+    a(70, 70) = -1e4;
+    ASSERT_ANY_THROW(TCholeskyDecomposition<double> chol(a));
+    ASSERT_ANY_THROW(TCholeskyDecomposition<double>(TDynamicMatrix<double>(3, 4)));
+}
+
+TEST(LDLTDecomposition, SolvesManyRightHandSides)
+{
+    const size_t n = 130;
+    const TDynamicMatrix<double> a = spd_matrix(n);
+    TDynamicMatrix<double> xs(n, 3);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            xs(i, j) = double(i % 5) + double(j);
+
+    TLDLTDecomposition<double> ldlt(a);
+    EXPECT_TRUE(ldlt.is_positive_definite());
+    EXPECT_LT(max_abs_diff(xs, ldlt.solve(a * xs)), 1e-9);
+
+    TDynamicMatrix<double> identity(n);
+    for (size_t i = 0; i < n; ++i) identity(i, i) = 1;
+    EXPECT_LT(max_abs_diff(identity, a * ldlt.inverse()), 1e-9);
+}
+
+TEST(LDLTDecomposition, FactorsSymmetricIndefiniteMatrix)
+{
+    TDynamicMatrix<double> a(2);
+    a(0, 0) = 1; a(0, 1) = 2;
+    a(1, 0) = 2; a(1, 1) = 1;
+    TLDLTDecomposition<double> ldlt(a);
+    EXPECT_FALSE(ldlt.is_positive_definite());
+    EXPECT_EQ(2, ldlt.unit_lower()(1, 0));
+    EXPECT_EQ(1, ldlt.diagonal()[0]);
+    EXPECT_EQ(-3, ldlt.diagonal()[1]);
+    EXPECT_EQ(-3, ldlt.determinant());
+
+    TDynamicVector<double> b(2);
+    b[0] = 5; b[1] = 4;
+    TDynamicVector<double> x = ldlt.solve(b);
+    EXPECT_NEAR(1, x[0], 1e-12);
+    EXPECT_NEAR(2, x[1], 1e-12);
+
+    a(0, 0) = 0;
+    ASSERT_ANY_THROW(TLDLTDecomposition<double> zero(a));
+}
+
+TEST(LDLTDecomposition, RejectsRankDeficientGramMatrix)
+{
+    // Gram matrix of three vectors in the plane, the third 0.1 v0 + 0.7 v1. Its
+    // last pivot rounds to a few eps instead of 0.
+    const double v[2][3] = { { 1, 2, 0.1 * 1 + 0.7 * 2 }, { 2, 0.5, 0.1 * 2 + 0.7 * 0.5 } };
+    TDynamicMatrix<double> a(3);
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            a(i, j) = v[0][i] * v[0][j] + v[1][i] * v[1][j];
+
+    ASSERT_ANY_THROW(TLDLTDecomposition<double> ldlt(a));
+    ASSERT_ANY_THROW(TCholeskyDecomposition<double> chol(a));
+
+    a(2, 2) += 1e-3;
+    TCholeskyDecomposition<double> chol(a);
+    EXPECT_DOUBLE_EQ(3 * std::numeric_limits<double>::epsilon() * 5, chol.pivot_tolerance());
+}
+
+static TDynamicMatrix<double> tall_matrix(size_t m, size_t n)
+{
+    TDynamicMatrix<double> a(m, n);
+    for (size_t i = 0; i < m; ++i)
+        for (size_t j = 0; j < n; ++j)
+            a(i, j) = double((i * 29 + j * 17 + i * j) % 31) / 31 - 0.5 + (i == j ? 2 : 0);
+    return a;
+}
+
+TEST(QRDecomposition, FactorsReproduceMatrix)
+{
+    const size_t m = 200, n = 150;
+    const TDynamicMatrix<double> a = tall_matrix(m, n);
+    TQRDecomposition<double> qr(a);
+    const TDynamicMatrix<double> q = qr.q(), r = qr.r();
+
+    TDynamicMatrix<double> identity(n);
+    for (size_t i = 0; i < n; ++i) identity(i, i) = 1;
+    EXPECT_LT(max_abs_diff(identity, TDynamicMatrix<double>(q.t()) * q), 1e-12);
+    EXPECT_LT(max_abs_diff(a, q * r), 1e-12);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < i; ++j)
+            EXPECT_EQ(0, r(i, j));
+}
+
+TEST(QRDecomposition, SolvesLeastSquaresProblem)
+{
+    const size_t m = 300, n = 90;
+    const TDynamicMatrix<double> a = tall_matrix(m, n);
+    TDynamicVector<double> x(n), b(m);
+    for (size_t i = 0; i < n; ++i) x[i] = double(i % 6) - 2.5;
+    for (size_t i = 0; i < m; ++i) b[i] = double(i % 11) - 5;
+
+    TDynamicVector<double> y = lstsq(a, a * x);
+    for (size_t i = 0; i < n; ++i) EXPECT_NEAR(x[i], y[i], 1e-10);
+
+    // The residual of the best fit is orthogonal to the columns of A.
+    const TDynamicVector<double> fit = lstsq(a, b);
+    const TDynamicVector<double> normal = TDynamicMatrix<double>(a.t()) * (a * fit - b);
+    for (size_t i = 0; i < n; ++i) EXPECT_NEAR(0, normal[i], 1e-9);
+}
+
+TEST(QRDecomposition, DetectsRankDeficiency)
+{
+    TDynamicMatrix<double> a = tall_matrix(20, 4);
+    for (size_t i = 0; i < 20; ++i) a(i, 3) = 0;
+    TQRDecomposition<double> qr(a);
+    EXPECT_FALSE(qr.is_full_rank());
+    ASSERT_ANY_THROW(qr.solve(TDynamicVector<double>(20)));
+    ASSERT_ANY_THROW(TQRDecomposition<double>(TDynamicMatrix<double>(3, 4)));
+    ASSERT_ANY_THROW(lstsq(tall_matrix(5, 3), TDynamicVector<double>(4)));
+
+    // A column that is a combination of others leaves R(i, i) at rounding level.
+    TDynamicMatrix<double> dependent = tall_matrix(90, 70);
+    for (size_t i = 0; i < 90; ++i) dependent(i, 69) = 0.3 * dependent(i, 2) - 1.7 * dependent(i, 40);
+    EXPECT_FALSE(TQRDecomposition<double>(dependent).is_full_rank());
+    ASSERT_ANY_THROW(lstsq(dependent, TDynamicVector<double>(90)));
+}
+
+TEST(TallSkinnyQR, MatchesHouseholderQR)
+{
+    const size_t m = 3000, n = 12;
+    const TDynamicMatrix<double> a = tall_matrix(m, n);
+    TDynamicVector<double> b(m);
+    for (size_t i = 0; i < m; ++i) b[i] = double(i % 7) - 3;
+
+    TThreadPool pool(4);
+    TTallSkinnyQR<double> tsqr(a, pool);
+    TQRDecomposition<double> qr(a);
+    EXPECT_EQ(4u, tsqr.block_count());
+
+    // R is unique up to the signs of its rows.
+    const TDynamicMatrix<double> r1 = tsqr.r(), r2 = qr.r();
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            EXPECT_NEAR(std::abs(r2(i, j)), std::abs(r1(i, j)), 1e-9);
+
+    const TDynamicVector<double> x1 = tsqr.solve(b), x2 = qr.solve(b), x3 = lstsq(a, b, pool);
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(x2[i], x1[i], 1e-10);
+        EXPECT_NEAR(x2[i], x3[i], 1e-10);
+    }
+}
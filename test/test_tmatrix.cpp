@@ -47,7 +47,7 @@ TEST(DynamicMatrix, CopyHasSeparateMemory)
 TEST(DynamicMatrix, GetSizeWorksCorrectly)
 {
     TDynamicMatrix<int> m(12);
-    EXPECT_EQ(12, m.get_size());
+    EXPECT_EQ(size_t(12), m.get_size());
 }
 
 TEST(DynamicMatrix, CanAccessElements)
@@ -77,7 +77,7 @@ TEST(DynamicMatrix, CanAssignMatrices)
     
     m2 = m1;
     EXPECT_EQ(m2[0][0], 10);
-    EXPECT_EQ(m2.get_size(), 5);
+    EXPECT_EQ(m2.get_size(), size_t(5));
 }
 
 TEST(DynamicMatrix, MatricesComparison)
@@ -157,3 +157,634 @@ TEST(DynamicMatrix, ScalarMultiplication)
     EXPECT_EQ(res[1][0], 6);
     EXPECT_EQ(res[1][1], 8);
 }
+
+TEST(DynamicMatrix, RowsShareOneContiguousBuffer)
+{
+    TDynamicMatrix<int> m(3);
+    m[1][2] = 7;
+
+    EXPECT_EQ(m.data() + m.get_stride(), &m[1][0]);
+    EXPECT_EQ(7, m.data()[m.get_stride() + 2]);
+}
+
+TEST(DynamicMatrix, CanAssignVectorToRow)
+{
+    TDynamicMatrix<int> m(3);
+    TDynamicVector<int> v(3);
+    v[0] = 1; v[1] = 2; v[2] = 3;
+
+    m[1] = v;
+    EXPECT_EQ(v, TDynamicVector<int>(m[1]));
+    ASSERT_ANY_THROW(m[0] = TDynamicVector<int>(2));
+}
+
+TEST(DynamicMatrix, BlockedMultiplicationMatchesNaive)
+{
+    const size_t n = 75;
+    TDynamicMatrix<int> m1(n), m2(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            m1[i][j] = int((i * 7 + j * 3) % 11) - 5;
+            m2[i][j] = int((i * 5 + j * 13) % 9) - 4;
+        }
+
+    TDynamicMatrix<int> res = m1 * m2;
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            int sum = 0;
+            for (size_t k = 0; k < n; k++)
+                sum += m1[i][k] * m2[k][j];
+            ASSERT_EQ(sum, res[i][j]);
+        }
+}
+
+TEST(DynamicMatrix, ParallelMultiplicationMatchesSerial)
+{
+    const size_t n = 150;
+    TDynamicMatrix<long long> m1(n), m2(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            m1[i][j] = (long long)((i + 2 * j) % 17) - 8;
+            m2[i][j] = (long long)((3 * i + j) % 13) - 6;
+        }
+
+    TThreadPool pool(4);
+    TSerialExecutor serial;
+    EXPECT_EQ(m1.multiply(m2, serial), m1.multiply(m2, pool));
+}
+
+TEST(DynamicMatrix, ChainedExpressionIsEvaluatedCorrectly)
+{
+    TDynamicMatrix<int> m1(2), m2(2);
+    m1[0][0] = 1; m1[0][1] = 2;
+    m1[1][0] = 3; m1[1][1] = 4;
+    m2[0][0] = 1; m2[1][1] = 1;
+
+    TDynamicMatrix<int> res = (m1 + m2) * 2 - m1;
+    EXPECT_EQ(res[0][0], 3);
+    EXPECT_EQ(res[0][1], 2);
+    EXPECT_EQ(res[1][0], 3);
+    EXPECT_EQ(res[1][1], 6);
+}
+
+TEST(DynamicMatrix, CanMultiplyExpressions)
+{
+    TDynamicMatrix<int> m1(2), m2(2);
+    TDynamicVector<int> v(2);
+    m1[0][0] = 1; m1[1][1] = 1;
+    m2[0][1] = 1; m2[1][0] = 1;
+    v[0] = 1; v[1] = 2;
+
+    TDynamicMatrix<int> prod = (m1 + m2) * (m1 - m2);
+    EXPECT_EQ(prod[0][0], 0);
+    EXPECT_EQ(prod[1][1], 0);
+
+    TDynamicVector<int> res = (m1 + m2) * (v + v);
+    EXPECT_EQ(res[0], 6);
+    EXPECT_EQ(res[1], 6);
+}
+
+TEST(DynamicMatrix, RowsTakePartInVectorExpressions)
+{
+    TDynamicMatrix<int> m(2);
+    m[0][0] = 1; m[0][1] = 2;
+    m[1][0] = 3; m[1][1] = 4;
+
+    TDynamicVector<int> sum = m[0] + m[1];
+    EXPECT_EQ(sum[0], 4);
+    EXPECT_EQ(sum[1], 6);
+    EXPECT_EQ(m[0] * m[1], 11);
+
+    m[1] = m[1] - m[0];
+    EXPECT_EQ(m[1][0], 2);
+    EXPECT_EQ(m[1][1], 2);
+}
+
+TEST(DynamicMatrix, CompoundAssignment)
+{
+    TDynamicMatrix<int> m1(2), m2(2);
+    m1[0][0] = 1; m1[1][1] = 2;
+    m2[0][0] = 1; m2[0][1] = 1;
+
+    m1 += m2;
+    EXPECT_EQ(m1[0][0], 2);
+    EXPECT_EQ(m1[0][1], 1);
+    m1 -= m2 * 2;
+    EXPECT_EQ(m1[0][0], 0);
+    m1 *= 5;
+    EXPECT_EQ(m1[1][1], 10);
+    m1.axpy(3, m2);
+    EXPECT_EQ(m1[0][1], -2);
+
+    ASSERT_ANY_THROW(m1 += TDynamicMatrix<int>(3));
+}
+
+TEST(DynamicMatrix, CanCreateUninitializedMatrix)
+{
+    TDynamicMatrix<int> m(4, uninitialized);
+    EXPECT_EQ(size_t(4), m.get_size());
+    ASSERT_ANY_THROW(TDynamicMatrix<int> w(0, uninitialized));
+    ASSERT_ANY_THROW(TDynamicMatrix<int> w(MAX_MATRIX_LEN + 10, uninitialized));
+}
+
+TEST(DynamicMatrix, AllocatesFromGivenResource)
+{
+    std::pmr::monotonic_buffer_resource arena;
+    TDynamicMatrix<int> m(4, &arena);
+    EXPECT_EQ(&arena, m.get_resource());
+
+    m = TDynamicMatrix<int>(6) * 2;
+    EXPECT_EQ(&arena, m.get_resource());
+    EXPECT_EQ(size_t(6), m.get_size());
+
+    TDynamicMatrix<int> c(m, &arena);
+    EXPECT_EQ(&arena, c.get_resource());
+    EXPECT_EQ(m, c);
+
+    TDynamicMatrix<double> a(40, &arena);
+    for (size_t i = 0; i < 40; ++i) a(i, (i * 7) % 40) = 1;
+    const TDynamicMatrix<double> classical = a.multiply(a, TMultiplyPolicy(MULTIPLY_CLASSICAL), matrix_executor());
+    const TDynamicMatrix<double> fast = a.multiply(a.t(), TMultiplyPolicy(MULTIPLY_STRASSEN, 8), matrix_executor());
+    EXPECT_EQ(&arena, classical.get_resource());
+    EXPECT_EQ(&arena, fast.get_resource());
+}
+
+TEST(DynamicMatrix, RowsArePaddedToCacheLines)
+{
+    TDynamicMatrix<double> m(5, uninitialized);
+    EXPECT_EQ(size_t(8), m.get_stride());
+    for (size_t i = 0; i < 5; i++)
+        EXPECT_EQ(uintptr_t(0), reinterpret_cast<uintptr_t>(m.row_data(i)) % 64);
+
+    TDynamicMatrix<int> a(17);
+    EXPECT_EQ(size_t(32), a.get_stride());
+    TDynamicMatrix<char> b(3);
+    EXPECT_EQ(size_t(64), b.get_stride());
+}
+
+TEST(DynamicMatrix, PaddedMatricesMultiplyCorrectly)
+{
+    const size_t n = 67;
+    TDynamicMatrix<double> a(n), id(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        id(i, i) = 1.0;
+        for (size_t j = 0; j < n; j++)
+            a(i, j) = double(i * n + j);
+    }
+    ASSERT_GT(a.get_stride(), n);
+
+    TDynamicMatrix<double> p = a * id;
+    EXPECT_EQ(a, p);
+    p = a;
+    EXPECT_EQ(a, p);
+}
+
+TEST(DynamicMatrix, CanCreateRectangularMatrix)
+{
+    TDynamicMatrix<int> m(3, 5);
+    EXPECT_EQ(size_t(3), m.rows());
+    EXPECT_EQ(size_t(5), m.cols());
+    EXPECT_FALSE(m.is_square());
+    EXPECT_EQ(size_t(5), m[2].length());
+    EXPECT_EQ(0, m(2, 4));
+    ASSERT_ANY_THROW(m[3]);
+
+    ASSERT_ANY_THROW(TDynamicMatrix<int>(0, 5));
+    ASSERT_ANY_THROW(TDynamicMatrix<int>(5, 0));
+    ASSERT_ANY_THROW(TDynamicMatrix<int>(1, MAX_MATRIX_LEN + 1));
+    EXPECT_TRUE(TDynamicMatrix<int>(4).is_square());
+}
+
+TEST(DynamicMatrix, RectangularArithmeticChecksShapes)
+{
+    TDynamicMatrix<int> a(2, 3), b(2, 3), c(3, 2);
+    a(1, 2) = 4;
+    b(1, 2) = 1;
+
+    TDynamicMatrix<int> s = a + b * 2;
+    EXPECT_EQ(size_t(2), s.rows());
+    EXPECT_EQ(size_t(3), s.cols());
+    EXPECT_EQ(6, s(1, 2));
+    EXPECT_NE(s, TDynamicMatrix<int>(2, 2));
+
+    ASSERT_ANY_THROW(a + c);
+    ASSERT_ANY_THROW(a - c);
+    ASSERT_ANY_THROW(a += c);
+    ASSERT_ANY_THROW(a * b);
+
+    a = c;
+    EXPECT_EQ(size_t(3), a.rows());
+    EXPECT_EQ(size_t(2), a.cols());
+}
+
+TEST(DynamicMatrix, CanMultiplyRectangularMatrices)
+{
+    const size_t m = 300, k = 64, n = 16;
+    TDynamicMatrix<double> a(m, k), b(k, n);
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < k; j++)
+            a(i, j) = double((i + 2 * j) % 7);
+    for (size_t i = 0; i < k; i++)
+        for (size_t j = 0; j < n; j++)
+            b(i, j) = double((3 * i + j) % 5);
+
+    TDynamicMatrix<double> c = a * b;
+    ASSERT_EQ(m, c.rows());
+    ASSERT_EQ(n, c.cols());
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            double expected = 0;
+            for (size_t p = 0; p < k; p++)
+                expected += a(i, p) * b(p, j);
+            EXPECT_EQ(expected, c(i, j));
+        }
+}
+
+TEST(DynamicMatrix, CanMultiplyRectangularMatrixByVector)
+{
+    TDynamicMatrix<int> m(2, 3);
+    TDynamicVector<int> v(3);
+    for (size_t j = 0; j < 3; j++)
+    {
+        m(0, j) = int(j);
+        m(1, j) = 1;
+        v[j] = int(j + 1);
+    }
+
+    TDynamicVector<int> r = m * v;
+    ASSERT_EQ(size_t(2), r.length());
+    EXPECT_EQ(8, r[0]);
+    EXPECT_EQ(6, r[1]);
+    ASSERT_ANY_THROW(m * TDynamicVector<int>(2));
+}
+
+TEST(DynamicMatrix, SizeArithmeticDetectsOverflow)
+{
+    EXPECT_EQ(size_t(1) << 40, tmemory::checked_mul(size_t(1) << 20, size_t(1) << 20));
+    ASSERT_THROW(tmemory::checked_mul(SIZE_MAX / 2, 3), length_error);
+    ASSERT_THROW(tmemory::padded_length<double>(SIZE_MAX - 1), length_error);
+    ASSERT_THROW(tmemory::allocate<double>(std::pmr::get_default_resource(), SIZE_MAX / 4),
+                 length_error);
+
+    EXPECT_TRUE(tkernels::gemm_work_at_most(32, 32, 32, 32 * 32 * 32));
+    EXPECT_FALSE(tkernels::gemm_work_at_most(33, 32, 32, 32 * 32 * 32));
+    EXPECT_FALSE(tkernels::gemm_work_at_most(size_t(1) << 22, size_t(1) << 22, size_t(1) << 22,
+                                             tkernels::GEMM_PARALLEL_WORK));
+}
+
+TEST(DynamicMatrix, MatrixVectorProductMatchesNaive)
+{
+    set_matrix_threads(4);
+    for (size_t rows : {1, 7, 301})
+    {
+        const size_t cols = 2 * tkernels::GEMV_NB + 37;
+        TDynamicMatrix<double> m(rows, cols);
+        TDynamicVector<double> v(cols), w(rows);
+        for (size_t i = 0; i < rows; i++)
+        {
+            w[i] = double(i % 3) - 1.0;
+            for (size_t j = 0; j < cols; j++)
+                m(i, j) = double((i + 3 * j) % 11) - 5.0;
+        }
+        for (size_t j = 0; j < cols; j++) v[j] = double(j % 5) - 2.0;
+
+        TDynamicVector<double> mv = m * v;
+        for (size_t i = 0; i < rows; i++)
+        {
+            double expected = 0;
+            for (size_t j = 0; j < cols; j++) expected += m(i, j) * v[j];
+            EXPECT_EQ(expected, mv[i]);
+        }
+
+        TDynamicVector<double> wm = w * m;
+        ASSERT_EQ(cols, wm.length());
+        for (size_t j = 0; j < cols; j++)
+        {
+            double expected = 0;
+            for (size_t i = 0; i < rows; i++) expected += w[i] * m(i, j);
+            EXPECT_EQ(expected, wm[j]);
+        }
+    }
+    set_matrix_threads(std::thread::hardware_concurrency());
+}
+
+TEST(DynamicMatrix, TransposedProductChecksDimensions)
+{
+    TDynamicMatrix<int> m(2, 3);
+    m(1, 2) = 5;
+    TDynamicVector<int> w(2);
+    w[1] = 2;
+
+    TDynamicVector<int> r = w * m;
+    ASSERT_EQ(size_t(3), r.length());
+    EXPECT_EQ(10, r[2]);
+    EXPECT_EQ(TDynamicVector<int>((w + w) * m), r * 2);
+    ASSERT_ANY_THROW(TDynamicVector<int>(3) * m);
+}
+
+TEST(DynamicMatrix, StrassenMatchesClassicalProduct)
+{
+    for (size_t n : {64, 67, 100, 131})
+    {
+        TDynamicMatrix<double> a(n), b(n);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+            {
+                a(i, j) = double((i * 7 + j) % 9) - 4.0;
+                b(i, j) = double((i + 3 * j) % 5) - 2.0;
+            }
+
+        TDynamicMatrix<double> classical = a.multiply(b, TMultiplyPolicy(MULTIPLY_CLASSICAL), matrix_executor());
+        TDynamicMatrix<double> fast = a.multiply(b, TMultiplyPolicy(MULTIPLY_STRASSEN, 16), matrix_executor());
+        EXPECT_EQ(classical, fast);
+    }
+}
+
+TEST(DynamicMatrix, GlobalMultiplyPolicySelectsStrassen)
+{
+    const size_t n = 45;
+    TDynamicMatrix<int> a(n), b(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+        {
+            a(i, j) = int((i + j) % 4);
+            b(i, j) = int(i == j) + int(j % 3);
+        }
+    TDynamicMatrix<int> expected = a * b;
+
+    set_multiply_policy(TMultiplyPolicy(MULTIPLY_STRASSEN, 8));
+    EXPECT_EQ(MULTIPLY_STRASSEN, multiply_policy().algorithm);
+    TDynamicMatrix<int> fast = a * b;
+    TDynamicMatrix<int> rect = TDynamicMatrix<int>(3, n) * b;
+    set_multiply_policy(TMultiplyPolicy());
+
+    EXPECT_EQ(expected, fast);
+    EXPECT_EQ(size_t(3), rect.rows());
+    EXPECT_EQ(MULTIPLY_CLASSICAL, multiply_policy().algorithm);
+}
+
+TEST(DynamicMatrix, StrassenWorkspaceCoversRecursion)
+{
+    EXPECT_EQ(size_t(0), tkernels::strassen_workspace(64, 64));
+    EXPECT_EQ(size_t(3 * 32 * 32), tkernels::strassen_workspace(64, 32));
+    EXPECT_EQ(size_t(3 * 32 * 32 + 3 * 16 * 16), tkernels::strassen_workspace(65, 16));
+}
+
+TEST(DynamicMatrix, OperatorsReuseRvalueStorage)
+{
+    TDynamicMatrix<int> a(3, 4), b(3, 4);
+    a(2, 3) = 2;
+    b(2, 3) = 5;
+
+    TDynamicMatrix<int> t(a);
+    const int* p = t.data();
+    TDynamicMatrix<int> r = std::move(t) * 3 + b - a;
+    EXPECT_EQ(p, r.data());
+    EXPECT_EQ(9, r(2, 3));
+
+    TDynamicMatrix<int> u(b);
+    p = u.data();
+    TDynamicMatrix<int> s = a - std::move(u);
+    EXPECT_EQ(p, s.data());
+    EXPECT_EQ(-3, s(2, 3));
+
+    TDynamicMatrix<int> sq(4);
+    sq(1, 1) = 1;
+    TDynamicMatrix<int> prod = a * sq + a;
+    EXPECT_EQ(size_t(3), prod.rows());
+    ASSERT_ANY_THROW(TDynamicMatrix<int>(4) + a);
+}
+
+TEST(DynamicMatrix, CopyOnWriteSharesUntilWritten)
+{
+    TDynamicMatrix<int> a(3, 4);
+    a(1, 2) = 7;
+
+    TDynamicMatrix<int> b(a, copy_on_write);
+    const TDynamicMatrix<int>& cb = b;
+    EXPECT_TRUE(a.is_shared());
+    EXPECT_EQ(static_cast<const TDynamicMatrix<int>&>(a).data(), cb.data());
+    EXPECT_EQ(7, cb(1, 2));
+    EXPECT_EQ(a, b);
+
+    b(1, 2) = 8;
+    EXPECT_FALSE(a.is_shared());
+    EXPECT_FALSE(b.is_shared());
+    EXPECT_EQ(7, a(1, 2));
+    EXPECT_EQ(8, b(1, 2));
+
+    TDynamicMatrix<int> c(a, copy_on_write);
+    a[0][0] = 1;
+    EXPECT_EQ(0, c(0, 0));
+    EXPECT_EQ(7, c(1, 2));
+}
+
+TEST(DynamicMatrix, CopyOnWriteOwnersOutliveEachOther)
+{
+    TDynamicMatrix<int>* a = new TDynamicMatrix<int>(5);
+    (*a)(4, 4) = 3;
+    TDynamicMatrix<int> b(*a, copy_on_write);
+    TDynamicMatrix<int> c(b, copy_on_write);
+    delete a;
+    EXPECT_TRUE(b.is_shared());
+    EXPECT_EQ(3, static_cast<const TDynamicMatrix<int>&>(c)(4, 4));
+
+    c *= 2;
+    EXPECT_FALSE(b.is_shared());
+    EXPECT_EQ(3, static_cast<const TDynamicMatrix<int>&>(b)(4, 4));
+    EXPECT_EQ(6, static_cast<const TDynamicMatrix<int>&>(c)(4, 4));
+}
+
+TEST(DynamicMatrix, AssignmentToSharedMatrixLeavesOtherOwners)
+{
+    TDynamicMatrix<int> a(3);
+    a(0, 1) = 2;
+    TDynamicMatrix<int> b(a, copy_on_write);
+
+    b = b + b;
+    EXPECT_EQ(2, a(0, 1));
+    EXPECT_EQ(4, b(0, 1));
+
+    TDynamicMatrix<int> c(a, copy_on_write);
+    c += a;
+    EXPECT_EQ(2, a(0, 1));
+    EXPECT_EQ(4, c(0, 1));
+
+    TDynamicMatrix<int> d(a, copy_on_write);
+    d = b;
+    EXPECT_FALSE(a.is_shared());
+    EXPECT_EQ(2, a(0, 1));
+    EXPECT_EQ(4, d(0, 1));
+}
+
+TEST(DynamicMatrix, BorrowedMatrixUsesCallerStride)
+{
+    int arr[3 * 5] = {};
+    for (int k = 0; k < 15; ++k) arr[k] = k;
+
+    TDynamicMatrix<int> m(arr, 3, 4, 5, borrow);
+    EXPECT_EQ(size_t(4), m.cols());
+    EXPECT_EQ(size_t(5), m.get_stride());
+    EXPECT_EQ(11, m(2, 1));
+
+    m(1, 3) = -1;
+    EXPECT_EQ(-1, arr[8]);
+
+    TDynamicMatrix<int> twice = m + m;
+    EXPECT_EQ(22, twice(2, 1));
+    m = twice;
+    EXPECT_EQ(22, arr[11]);
+    EXPECT_EQ(4, arr[4]);
+
+    ASSERT_ANY_THROW(TDynamicMatrix<int>(arr, 3, 4, 3, borrow));
+}
+
+TEST(DynamicMatrix, AdoptedMatrixIsReleasedByLastSharer)
+{
+    int deleted = 0;
+    auto deleter = [&deleted](double* p) { ++deleted; delete[] p; };
+    {
+        TDynamicMatrix<double> a(new double[4](), 2, 2, 2, adopt, deleter);
+        TDynamicMatrix<double> b(a, copy_on_write);
+        b(0, 0) = 1;
+        EXPECT_EQ(0, deleted);
+        TDynamicMatrix<double> c(a, copy_on_write);
+        a = TDynamicMatrix<double>(3);
+        EXPECT_EQ(0, deleted);
+    }
+    EXPECT_EQ(1, deleted);
+
+    ASSERT_ANY_THROW(TDynamicMatrix<double>(new double[4](), 2, 2, 1, adopt, deleter));
+    EXPECT_EQ(2, deleted);
+}
+
+template<typename T>
+static TDynamicMatrix<T> numbered_matrix(size_t rows, size_t cols)
+{
+    TDynamicMatrix<T> m(rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            m(i, j) = T(i * cols + j);
+    return m;
+}
+
+template<typename T>
+static void check_transpose(size_t rows, size_t cols)
+{
+    const TDynamicMatrix<T> m = numbered_matrix<T>(rows, cols);
+    TDynamicMatrix<T> t = m.transpose();
+    ASSERT_EQ(cols, t.rows());
+    ASSERT_EQ(rows, t.cols());
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            ASSERT_EQ(m(i, j), t(j, i));
+
+    TDynamicMatrix<T> in(m);
+    in.transpose_inplace();
+    EXPECT_EQ(t, in);
+    in.transpose_inplace();
+    EXPECT_EQ(m, in);
+}
+
+TEST(DynamicMatrix, TransposeMatchesDefinitionOnEveryLevel)
+{
+    const tsimd::TSimdLevel detected = tsimd::detect_simd_level();
+    for (int level = tsimd::SIMD_SCALAR; level <= detected; level++)
+    {
+        tsimd::set_simd_level(tsimd::TSimdLevel(level));
+        check_transpose<double>(70, 45);
+        check_transpose<double>(67, 67);
+        check_transpose<float>(33, 100);
+        check_transpose<float>(64, 64);
+    }
+    tsimd::set_simd_level(detected);
+    check_transpose<int>(5, 3);
+    check_transpose<int>(1, 1);
+}
+
+TEST(DynamicMatrix, AssignsTransposeWithoutAliasing)
+{
+    const TDynamicMatrix<int> a = numbered_matrix<int>(40, 40);
+    TDynamicMatrix<int> m(a);
+    m = m.t();
+    EXPECT_EQ(a.transpose(), m);
+
+    TDynamicMatrix<int> r = numbered_matrix<int>(3, 5);
+    r = r.t();
+    EXPECT_EQ(size_t(5), r.rows());
+    EXPECT_EQ(7, r(2, 1));
+
+    TDynamicMatrix<int> b(40, 40);
+    b = a.t();
+    EXPECT_EQ(a.transpose(), b);
+
+    TDynamicMatrix<int> s(a);
+    s = s.submatrix(0, 1, 40, 39).t();
+    EXPECT_EQ(size_t(39), s.rows());
+    EXPECT_EQ(a(3, 2), s(1, 3));
+
+    TDynamicMatrix<int> shared(a, copy_on_write);
+    shared = shared.t();
+    EXPECT_EQ(1, a(0, 1));
+    EXPECT_EQ(40, shared(0, 1));
+}
+
+TEST(DynamicMatrix, ExpressionReadingOwnTransposeDoesNotAlias)
+{
+    const TDynamicMatrix<int> a = numbered_matrix<int>(40, 40);
+    const TDynamicMatrix<int> at = a.transpose();
+
+    TDynamicMatrix<int> m(a);
+    m = a + m.t();
+    EXPECT_EQ(TDynamicMatrix<int>(a + at), m);
+
+    TDynamicMatrix<int> s(a);
+    s = s.t() * 2;
+    EXPECT_EQ(TDynamicMatrix<int>(at * 2), s);
+
+    TDynamicMatrix<int> u(a);
+    u -= u.t();
+    EXPECT_EQ(TDynamicMatrix<int>(a - at), u);
+}
+
+TEST(DynamicMatrix, LazyTransposeInProducts)
+{
+    TDynamicMatrix<double> a(37, 50), b(29, 50), c(37, 29);
+    for (size_t i = 0; i < 37; ++i)
+        for (size_t j = 0; j < 50; ++j)
+            a(i, j) = double((i * 7 + j * 3) % 11) - 5;
+    for (size_t i = 0; i < 29; ++i)
+        for (size_t j = 0; j < 50; ++j)
+            b(i, j) = double((i * 5 + j) % 13) - 6;
+    for (size_t i = 0; i < 37; ++i)
+        for (size_t j = 0; j < 29; ++j)
+            c(i, j) = double(i) - double(j);
+
+    const TDynamicMatrix<double> bt = b.transpose(), at = a.transpose();
+    EXPECT_EQ(a * bt, a * b.t());
+    EXPECT_EQ(at * c, a.t() * c);
+    EXPECT_EQ(c.transpose() * a, c.t() * a);
+    EXPECT_EQ(bt.transpose() * at, b.t().t() * a.t());
+    EXPECT_EQ(b.transpose(), TDynamicMatrix<double>(b.t()));
+
+    TDynamicVector<double> x(37), y(50);
+    for (size_t i = 0; i < 37; ++i) x[i] = double(i % 4);
+    for (size_t i = 0; i < 50; ++i) y[i] = double(i % 3) - 1;
+    EXPECT_EQ(at * x, a.t() * x);
+    EXPECT_EQ(y * at, y * a.t());
+    ASSERT_ANY_THROW(a.t() * y);
+
+    TDynamicMatrix<double> sq(48, 48);
+    for (size_t i = 0; i < 48; ++i)
+        for (size_t j = 0; j < 48; ++j)
+            sq(i, j) = double((i + 2 * j) % 9);
+    const TMultiplyPolicy strassen(MULTIPLY_STRASSEN, 16);
+    const TDynamicMatrix<double> expected = sq.multiply(sq.transpose(), TMultiplyPolicy(), matrix_executor());
+    EXPECT_EQ(expected, sq.multiply(sq.t(), strassen, matrix_executor()));
+    EXPECT_EQ(expected, sq.view().multiply(sq.t(), strassen, matrix_executor()));
+}
@@ -0,0 +1,110 @@
+#include "tsimd.h"
+#include <gtest.h>
+#include <vector>
+
+template<typename T>
+void check_kernels_on_every_level()
+{
+    const size_t n = 37;
+    std::vector<T> a(n), b(n), r(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = T(int(i % 7) - 3);
+        b[i] = T(int(i % 5) + 1);
+    }
+
+    const tsimd::TSimdLevel detected = tsimd::detect_simd_level();
+    for (int level = tsimd::SIMD_SCALAR; level <= detected; level++)
+    {
+        tsimd::set_simd_level(tsimd::TSimdLevel(level));
+        T expectedDot = T();
+
+        tsimd::add(n, a.data(), b.data(), r.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(T(a[i] + b[i]), r[i]);
+
+        tsimd::sub(n, a.data(), b.data(), r.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(T(a[i] - b[i]), r[i]);
+
+        tsimd::scale(n, a.data(), T(3), r.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(T(a[i] * T(3)), r[i]);
+
+        r = b;
+        tsimd::axpy(n, T(2), a.data(), r.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(T(b[i] + T(2) * a[i]), r[i]);
+
+        r = b;
+        tsimd::mul_add(n, a.data(), b.data(), r.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(T(b[i] + a[i] * b[i]), r[i]);
+
+        for (size_t i = 0; i < n; i++) expectedDot += a[i] * b[i];
+        ASSERT_EQ(expectedDot, tsimd::dot(n, a.data(), b.data()));
+
+        T dots[4];
+        tsimd::dot4(n, a.data(), b.data(), a.data(), r.data(), b.data(), dots);
+        ASSERT_EQ(expectedDot, dots[0]);
+        ASSERT_EQ(tsimd::dot(n, b.data(), b.data()), dots[1]);
+        ASSERT_EQ(expectedDot, dots[2]);
+        ASSERT_EQ(tsimd::dot(n, r.data(), b.data()), dots[3]);
+    }
+    tsimd::set_simd_level(detected);
+}
+
+template<typename T>
+void check_transpose_tile_on_every_level()
+{
+    const size_t lda = 11, ldb = 13;
+    std::vector<T> a(8 * lda), b(8 * ldb);
+    for (size_t i = 0; i < a.size(); i++) a[i] = T(i);
+
+    const tsimd::TSimdLevel detected = tsimd::detect_simd_level();
+    for (int level = tsimd::SIMD_SCALAR; level <= detected; level++)
+    {
+        tsimd::set_simd_level(tsimd::TSimdLevel(level));
+        const size_t t = tsimd::transpose_tile_size<T>();
+        ASSERT_LE(t, 8u);
+        std::fill(b.begin(), b.end(), T(-1));
+        tsimd::transpose_tile(a.data(), lda, b.data(), ldb);
+        for (size_t i = 0; i < t; i++)
+            for (size_t j = 0; j < t; j++)
+                ASSERT_EQ(a[i * lda + j], b[j * ldb + i]);
+        for (size_t j = 0; j < 8; j++)
+            for (size_t i = t; i < ldb; i++)
+                ASSERT_EQ(T(-1), b[j * ldb + i]);
+    }
+    tsimd::set_simd_level(detected);
+}
+
+TEST(Simd, TransposeTilesMatchScalar)
+{
+    check_transpose_tile_on_every_level<float>();
+    check_transpose_tile_on_every_level<double>();
+    EXPECT_EQ(0u, tsimd::transpose_tile_size<int>());
+}
+
+TEST(Simd, FloatKernelsMatchScalar)
+{
+    check_kernels_on_every_level<float>();
+}
+
+TEST(Simd, DoubleKernelsMatchScalar)
+{
+    check_kernels_on_every_level<double>();
+}
+
+TEST(Simd, Int32KernelsMatchScalar)
+{
+    check_kernels_on_every_level<int>();
+    check_kernels_on_every_level<unsigned int>();
+}
+
+TEST(Simd, Int64KernelsMatchScalar)
+{
+    check_kernels_on_every_level<long long>();
+}
+
+TEST(Simd, CannotRaiseLevelAboveDetected)
+{
+    const tsimd::TSimdLevel detected = tsimd::detect_simd_level();
+    tsimd::set_simd_level(tsimd::SIMD_AVX512);
+    EXPECT_EQ(detected, tsimd::simd_level());
+}
@@ -0,0 +1,280 @@
+#include "tsolvers.h"
+#include "tbandmatrix.h"
+#include <gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Every global operator new of the test program is counted, on any thread, so a
+// test can check that a piece of code does not touch the heap at all. Aligned
+// blocks keep the pointer malloc returned just below the aligned address.
+static std::atomic<size_t> global_allocations(0);
+
+void* operator new(size_t size)
+{
+    ++global_allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t al)
+{
+    ++global_allocations;
+    const size_t align = static_cast<size_t>(al);
+    void* raw = std::malloc(size + align + sizeof(void*));
+    if (raw == nullptr) throw std::bad_alloc();
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    void** p = reinterpret_cast<void**>((start + align - 1) / align * align);
+    p[-1] = raw;
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    if (p != nullptr) std::free(static_cast<void**>(p)[-1]);
+}
+
+void operator delete(void* p, size_t, std::align_val_t al) noexcept
+{
+    operator delete(p, al);
+}
+
+// 5-point Laplacian on a k x k grid, symmetric positive definite.
+static TCsrMatrix<double> poisson_matrix(size_t k)
+{
+    TCooMatrix<double> coo(k * k, k * k);
+    for (size_t i = 0; i < k; ++i)
+        for (size_t j = 0; j < k; ++j)
+        {
+            const size_t r = i * k + j;
+            coo.add(r, r, 4);
+            if (i > 0) coo.add(r, r - k, -1);
+            if (i + 1 < k) coo.add(r, r + k, -1);
+            if (j > 0) coo.add(r, r - 1, -1);
+            if (j + 1 < k) coo.add(r, r + 1, -1);
+        }
+    return TCsrMatrix<double>(coo);
+}
+
+// 1D convection-diffusion, nonsymmetric and diagonally dominant.
+static TBandMatrix<double> convection_matrix(size_t n)
+{
+    TBandMatrix<double> a(n, 1, 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a(i, i) = 2.5 + double(i % 3) / 2;
+        if (i > 0) a(i, i - 1) = -1.5;
+        if (i + 1 < n) a(i, i + 1) = -0.5;
+    }
+    return a;
+}
+
+template<typename Op>
+static double relative_residual(const Op& a, const TDynamicVector<double>& b, const TDynamicVector<double>& x)
+{
+    TDynamicVector<double> r(b.length());
+    a(x, r);
+    double num = 0, den = 0;
+    for (size_t i = 0; i < b.length(); ++i)
+    {
+        num += (b[i] - r[i]) * (b[i] - r[i]);
+        den += b[i] * b[i];
+    }
+    return std::sqrt(num / den);
+}
+
+static TDynamicVector<double> test_rhs(size_t n)
+{
+    TDynamicVector<double> b(n);
+    for (size_t i = 0; i < n; ++i) b[i] = double(i % 7) - 3 + 0.25;
+    return b;
+}
+
+TEST(IterativeSolvers, ConjugateGradientSolvesPoisson)
+{
+    const TCsrMatrix<double> a = poisson_matrix(30);
+    const TDynamicVector<double> b = test_rhs(a.rows());
+    const auto op = linear_operator(a);
+
+    TDynamicVector<double> x(b.length());
+    const TSolverResult plain = cg(op, b, x);
+    EXPECT_TRUE(plain.converged);
+    EXPECT_LT(relative_residual(op, b, x), 1e-9);
+
+    TDynamicVector<double> xj(b.length());
+    EXPECT_TRUE(cg(op, b, xj, TJacobiPreconditioner<double>(a)).converged);
+    EXPECT_LT(relative_residual(op, b, xj), 1e-9);
+
+    TDynamicVector<double> xi(b.length());
+    const TSolverResult ilu = cg(op, b, xi, TILU0Preconditioner<double>(a));
+    EXPECT_TRUE(ilu.converged);
+    EXPECT_LT(relative_residual(op, b, xi), 1e-9);
+    EXPECT_LT(ilu.iterations, plain.iterations);
+}
+
+TEST(IterativeSolvers, BiCGStabSolvesNonsymmetricBandSystem)
+{
+    const TBandMatrix<double> a = convection_matrix(500);
+    const TDynamicVector<double> b = test_rhs(500);
+    const auto op = linear_operator(a);
+
+    TDynamicVector<double> x(500);
+    EXPECT_TRUE(bicgstab(op, b, x).converged);
+    EXPECT_LT(relative_residual(op, b, x), 1e-9);
+
+    TDynamicVector<double> xi(500);
+    const TCsrMatrix<double> csr(a.to_dense());
+    const TSolverResult ilu = bicgstab(op, b, xi, TILU0Preconditioner<double>(csr));
+    EXPECT_TRUE(ilu.converged);
+    // ILU(0) of a tridiagonal matrix is its exact LU.
+    EXPECT_LE(ilu.iterations, 2u);
+    EXPECT_LT(relative_residual(op, b, xi), 1e-9);
+}
+
+TEST(IterativeSolvers, RestartedGMRESSolvesDenseSystem)
+{
+    const size_t n = 200;
+    TDynamicMatrix<double> a(n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            a(i, j) = (i == j ? 2.0 : 0.0) + double((i * 7 + j * 3) % 11) / (11.0 * n);
+    const TDynamicVector<double> b = test_rhs(n);
+    const auto op = linear_operator(a);
+
+    TSolverOptions opts;
+    opts.restart = 5;
+    TDynamicVector<double> x(n);
+    const TSolverResult res = gmres(op, b, x, TJacobiPreconditioner<double>(a), opts);
+    EXPECT_TRUE(res.converged);
+    EXPECT_LT(relative_residual(op, b, x), 1e-9);
+
+    TDynamicVector<double> xs(n);
+    EXPECT_TRUE(gmres(linear_operator(convection_matrix(n)), b, xs, opts).converged);
+}
+
+TEST(IterativeSolvers, AcceptMatrixFreeOperator)
+{
+    const size_t n = 100;
+    // 1D Laplacian with Dirichlet boundaries, applied without storing a matrix.
+    auto laplacian = [](const TDynamicVector<double>& x, TDynamicVector<double>& y)
+    {
+        const size_t n = x.length();
+        for (size_t i = 0; i < n; ++i)
+            y[i] = 2 * x[i] - (i > 0 ? x[i - 1] : 0) - (i + 1 < n ? x[i + 1] : 0);
+    };
+    const TDynamicVector<double> b = test_rhs(n);
+
+    TDynamicVector<double> x(n), y(n), z(n);
+    EXPECT_TRUE(cg(laplacian, b, x).converged);
+    EXPECT_TRUE(bicgstab(laplacian, b, y).converged);
+    TSolverOptions opts;
+    opts.restart = n;
+    EXPECT_TRUE(gmres(laplacian, b, z, opts).converged);
+    for (size_t i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(x[i], y[i], 1e-6);
+        EXPECT_NEAR(x[i], z[i], 1e-6);
+    }
+}
+
+TEST(IterativeSolvers, ReportFailureToConverge)
+{
+    const TCsrMatrix<double> a = poisson_matrix(20);
+    const TDynamicVector<double> b = test_rhs(a.rows());
+    TSolverOptions opts;
+    opts.max_iterations = 3;
+
+    TDynamicVector<double> x(b.length());
+    const TSolverResult res = cg(linear_operator(a), b, x, opts);
+    EXPECT_FALSE(res.converged);
+    EXPECT_EQ(3u, res.iterations);
+    EXPECT_GT(res.residual, 1e-3);
+
+    TDynamicVector<double> shortX(5);
+    ASSERT_ANY_THROW(cg(linear_operator(a), b, shortX, opts));
+}
+
+class TAllocationCounter : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST(IterativeSolvers, DoNotAllocatePerIteration)
+{
+    const TCsrMatrix<double> a = poisson_matrix(20);
+    const TDynamicVector<double> b = test_rhs(a.rows());
+    const TILU0Preconditioner<double> ilu(a);
+    const auto op = linear_operator(a);
+
+    // The number of allocations must not depend on the number of iterations.
+    auto count = [&](size_t iterations, int solver)
+    {
+        TSolverOptions opts;
+        opts.max_iterations = iterations;
+        opts.restart = 4;
+        TDynamicVector<double> x(b.length());
+        TAllocationCounter counting;
+        TDefaultResourceScope scope(&counting);
+        if (solver == 0) cg(op, b, x, ilu, opts);
+        else if (solver == 1) bicgstab(op, b, x, ilu, opts);
+        else gmres(op, b, x, ilu, opts);
+        return counting.allocations;
+    };
+    for (int solver = 0; solver < 3; ++solver)
+        EXPECT_EQ(count(2, solver), count(20, solver));
+}
+
+TEST(IterativeSolvers, DoNotAllocatePerIterationOnParallelVectors)
+{
+    TThreadPool pool(4);
+    set_matrix_executor(&pool);
+
+    // Long enough for every vector operation to be split across the pool.
+    const TCsrMatrix<double> a = poisson_matrix(260);
+    ASSERT_GE(a.rows(), 2 * PARALLEL_GRAIN);
+    const TDynamicVector<double> b = test_rhs(a.rows());
+    const TJacobiPreconditioner<double> jacobi(a);
+    const auto op = linear_operator(a);
+
+    auto count = [&](size_t iterations, int solver)
+    {
+        TSolverOptions opts;
+        opts.max_iterations = iterations;
+        opts.restart = 4;
+        TDynamicVector<double> x(b.length());
+        const size_t before = global_allocations;
+        if (solver == 0) cg(op, b, x, jacobi, opts);
+        else if (solver == 1) bicgstab(op, b, x, jacobi, opts);
+        else gmres(op, b, x, jacobi, opts);
+        return global_allocations - before;
+    };
+    for (int solver = 0; solver < 3; ++solver)
+    {
+        count(2, solver);
+        EXPECT_EQ(count(2, solver), count(20, solver));
+    }
+
+    set_matrix_executor(nullptr);
+}
@@ -0,0 +1,106 @@
+#include "tsparsematrix.h"
+#include <gtest.h>
+
+static TDynamicMatrix<int> make_sparse_dense(size_t rows, size_t cols, int seed)
+{
+    TDynamicMatrix<int> m(rows, cols);
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+            if ((i * 31 + j * 17 + seed) % 7 == 0)
+                m(i, j) = int((i + 2 * j + seed) % 9) - 4;
+    return m;
+}
+
+TEST(TSparseMatrix, ThrowsOnInvalidShape)
+{
+    ASSERT_ANY_THROW(TCooMatrix<int>(0, 3));
+    ASSERT_ANY_THROW(TCsrMatrix<int>(3, 0));
+    ASSERT_ANY_THROW(TCscMatrix<int>(MAX_VECTOR_LEN + 1, 1));
+}
+
+TEST(TSparseMatrix, CooSumsDuplicatesOnCompression)
+{
+    TCooMatrix<int> coo(3, 4);
+    coo.add(2, 3, 5);
+    coo.add(0, 1, 1);
+    coo.add(2, 0, 4);
+    coo.add(0, 1, 2);
+    ASSERT_ANY_THROW(coo.add(3, 0, 1));
+    EXPECT_EQ(size_t(4), coo.nnz());
+
+    TCsrMatrix<int> csr(coo);
+    EXPECT_EQ(size_t(3), csr.nnz());
+    EXPECT_EQ(3, csr(0, 1));
+    EXPECT_EQ(4, csr(2, 0));
+    EXPECT_EQ(5, csr(2, 3));
+    EXPECT_EQ(0, csr(1, 1));
+    EXPECT_EQ(size_t(0), csr.col_indices()[csr.row_ptr()[2]]);
+
+    TCscMatrix<int> csc(coo);
+    EXPECT_EQ(size_t(3), csc.nnz());
+    EXPECT_EQ(csr.to_dense(), csc.to_dense());
+    ASSERT_ANY_THROW(csc(0, 4));
+}
+
+TEST(TSparseMatrix, ConvertsBetweenFormats)
+{
+    TDynamicMatrix<int> d = make_sparse_dense(9, 13, 1);
+    TCsrMatrix<int> csr(d);
+    TCscMatrix<int> csc(d);
+
+    EXPECT_EQ(d, csr.to_dense());
+    EXPECT_EQ(d, csc.to_dense());
+    EXPECT_EQ(d, TCscMatrix<int>(csr).to_dense());
+    EXPECT_EQ(d, TCsrMatrix<int>(csc).to_dense());
+    EXPECT_EQ(csr.nnz(), csc.nnz());
+    EXPECT_LT(csr.nnz(), size_t(9 * 13 / 3));
+}
+
+TEST(TSparseMatrix, SpMVMatchesDenseProduct)
+{
+    TDynamicMatrix<int> d = make_sparse_dense(40, 25, 3);
+    TDynamicVector<int> x(25);
+    for (size_t i = 0; i < 25; i++) x[i] = int(i % 5) - 2;
+
+    TDynamicVector<int> expected = d * x;
+    EXPECT_EQ(expected, TCsrMatrix<int>(d) * x);
+    EXPECT_EQ(expected, TCscMatrix<int>(d) * x);
+    EXPECT_EQ(TDynamicVector<int>(d * (x + x)), TCsrMatrix<int>(d) * (x + x));
+    ASSERT_ANY_THROW(TCsrMatrix<int>(d) * TDynamicVector<int>(40));
+}
+
+TEST(TSparseMatrix, LargeSpMVRunsInParallel)
+{
+    const size_t n = 200000;
+    TCooMatrix<double> coo(n, n);
+    coo.reserve(3 * n);
+    for (size_t i = 0; i < n; i++)
+    {
+        coo.add(i, i, 2.0);
+        if (i > 0) coo.add(i, i - 1, -1.0);
+        if (i + 1 < n) coo.add(i, i + 1, -1.0);
+    }
+    TCsrMatrix<double> a(coo);
+    TDynamicVector<double> x(n);
+    for (size_t i = 0; i < n; i++) x[i] = 1.0;
+
+    TDynamicVector<double> y = a * x;
+    EXPECT_EQ(1.0, y[0]);
+    EXPECT_EQ(0.0, y[n / 2]);
+    EXPECT_EQ(1.0, y[n - 1]);
+}
+
+TEST(TSparseMatrix, SpGEMMMatchesDenseProduct)
+{
+    TDynamicMatrix<int> a = make_sparse_dense(30, 20, 2), b = make_sparse_dense(20, 35, 5);
+    TCsrMatrix<int> c = TCsrMatrix<int>(a) * TCsrMatrix<int>(b);
+
+    EXPECT_EQ(size_t(30), c.rows());
+    EXPECT_EQ(size_t(35), c.cols());
+    EXPECT_EQ(a * b, c.to_dense());
+    for (size_t i = 0; i < c.rows(); i++)
+        for (size_t k = c.row_ptr()[i] + 1; k < c.row_ptr()[i + 1]; k++)
+            EXPECT_LT(c.col_indices()[k - 1], c.col_indices()[k]);
+
+    ASSERT_ANY_THROW(TCsrMatrix<int>(a) * TCsrMatrix<int>(a));
+}
@@ -0,0 +1,45 @@
+#include "tthreadpool.h"
+#include <gtest.h>
+#include <stdexcept>
+
+TEST(ThreadPool, RunsEveryTaskOnce)
+{
+    TThreadPool pool(4);
+    std::vector<int> hits(1000, 0);
+
+    pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+
+    for (size_t i = 0; i < hits.size(); i++)
+        ASSERT_EQ(1, hits[i]);
+}
+
+TEST(ThreadPool, NestedParallelForDoesNotDeadlock)
+{
+    TThreadPool pool(3);
+    std::atomic<int> count(0);
+
+    pool.parallel_for(8, [&](size_t)
+    {
+        pool.parallel_for(8, [&](size_t) { count++; });
+    });
+
+    EXPECT_EQ(64, count.load());
+}
+
+TEST(ThreadPool, RethrowsTaskException)
+{
+    TThreadPool pool(2);
+    ASSERT_ANY_THROW(pool.parallel_for(10, [](size_t i)
+    {
+        if (i == 7) throw std::runtime_error("task failed");
+    }));
+}
+
+TEST(ThreadPool, ReportsConcurrency)
+{
+    TThreadPool pool(5);
+    TSerialExecutor serial;
+
+    EXPECT_EQ(size_t(5), pool.concurrency());
+    EXPECT_EQ(size_t(1), serial.concurrency());
+}
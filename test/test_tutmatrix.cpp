@@ -0,0 +1,117 @@
+#include "tutmatrix.h"
+#include <gtest.h>
+
+static TUpperTriangularMatrix<int> make_triangular(size_t n, int seed)
+{
+    TUpperTriangularMatrix<int> m(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++)
+            m(i, j) = int((i * 7 + j * 3 + seed) % 11) - 5;
+    return m;
+}
+
+TEST(TUpperTriangularMatrix, CanCreateMatrixWithPositiveSize)
+{
+    ASSERT_NO_THROW(TUpperTriangularMatrix<int> m(5));
+}
+
+TEST(TUpperTriangularMatrix, ThrowsOnInvalidSize)
+{
+    ASSERT_ANY_THROW(TUpperTriangularMatrix<int> m(0));
+    ASSERT_ANY_THROW(TUpperTriangularMatrix<int> m(MAX_MATRIX_LEN + 1));
+}
+
+TEST(TUpperTriangularMatrix, StoresOnlyUpperHalf)
+{
+    TUpperTriangularMatrix<int> m(4);
+    EXPECT_EQ(size_t(10), m.packed_size());
+    m(1, 3) = 7;
+    EXPECT_EQ(7, m.at(1, 3));
+    EXPECT_EQ(size_t(3), m.row_length(1));
+    EXPECT_EQ(7, m.row_data(1)[2]);
+
+    const TUpperTriangularMatrix<int>& c = m;
+    EXPECT_EQ(0, c(3, 1));
+    ASSERT_ANY_THROW(m.at(3, 1));
+    ASSERT_ANY_THROW(m.at(4, 4));
+}
+
+TEST(TUpperTriangularMatrix, CanConvertToAndFromDense)
+{
+    TUpperTriangularMatrix<int> u = make_triangular(5, 1);
+    TDynamicMatrix<int> d = u.to_dense();
+    for (size_t i = 0; i < 5; i++)
+        for (size_t j = 0; j < 5; j++)
+            EXPECT_EQ(j < i ? 0 : u(i, j), d(i, j));
+
+    d(4, 0) = 100;
+    EXPECT_EQ(u, TUpperTriangularMatrix<int>(d));
+    ASSERT_ANY_THROW(TUpperTriangularMatrix<int>(TDynamicMatrix<int>(2, 3)));
+}
+
+TEST(TUpperTriangularMatrix, CanAddAndSubtract)
+{
+    TUpperTriangularMatrix<int> a = make_triangular(6, 1), b = make_triangular(6, 4);
+    TDynamicMatrix<int> sum = a.to_dense() + b.to_dense();
+    TDynamicMatrix<int> diff = a.to_dense() - b.to_dense();
+
+    EXPECT_EQ(sum, (a + b).to_dense());
+    EXPECT_EQ(diff, (a - b).to_dense());
+    EXPECT_EQ(TDynamicMatrix<int>(a.to_dense() * 3), (a * 3).to_dense());
+
+    a += b;
+    EXPECT_EQ(sum, a.to_dense());
+    a -= b;
+    a -= b;
+    EXPECT_EQ(diff, a.to_dense());
+
+    ASSERT_ANY_THROW(a + TUpperTriangularMatrix<int>(5));
+}
+
+TEST(TUpperTriangularMatrix, CanMultiplyByVector)
+{
+    TUpperTriangularMatrix<int> u = make_triangular(7, 2);
+    TDynamicVector<int> x(7);
+    for (size_t i = 0; i < 7; i++) x[i] = int(i) - 3;
+
+    EXPECT_EQ(u.to_dense() * x, u * x);
+    ASSERT_ANY_THROW(u * TDynamicVector<int>(6));
+}
+
+TEST(TUpperTriangularMatrix, ProductOfTriangularMatricesIsTriangular)
+{
+    for (size_t n : {1, 2, 9, 70})
+    {
+        TUpperTriangularMatrix<int> a = make_triangular(n, 3), b = make_triangular(n, 5);
+        EXPECT_EQ(a.to_dense() * b.to_dense(), (a * b).to_dense());
+    }
+    ASSERT_ANY_THROW(make_triangular(3, 0) * make_triangular(4, 0));
+}
+
+TEST(TUpperTriangularMatrix, ParallelProductsMatchDense)
+{
+    TThreadPool pool(4);
+    set_matrix_executor(&pool);
+
+    TUpperTriangularMatrix<int> u = make_triangular(600, 1);
+    TDynamicVector<int> x(600);
+    for (size_t i = 0; i < 600; i++) x[i] = int(i % 9) - 4;
+    EXPECT_EQ(u.to_dense() * x, u * x);
+
+    TUpperTriangularMatrix<int> a = make_triangular(130, 3), b = make_triangular(130, 5);
+    EXPECT_EQ(a.to_dense() * b.to_dense(), (a * b).to_dense());
+
+    set_matrix_executor(nullptr);
+}
+
+TEST(TUpperTriangularMatrix, TakesPartInDenseExpressions)
+{
+    TUpperTriangularMatrix<int> u = make_triangular(4, 6);
+    TDynamicMatrix<int> d(4);
+    d(3, 0) = 1;
+
+    TDynamicMatrix<int> r = d + u;
+    EXPECT_EQ(1, r(3, 0));
+    EXPECT_EQ(u(0, 3), r(0, 3));
+    EXPECT_EQ(u.to_dense() * d, u * d);
+}
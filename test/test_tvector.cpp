@@ -34,7 +34,7 @@ TEST(DynamicVector, CopyIsDeep)
 TEST(DynamicVector, GetSizeTest)
 {
     TDynamicVector<int> v(7);
-    EXPECT_EQ(7, v.length());
+    EXPECT_EQ(size_t(7), v.length());
 }
 
 TEST(DynamicVector, AccessBoundaryCheck)
@@ -49,7 +49,7 @@ TEST(DynamicVector, AssignmentOperator)
     v1[0] = 7;
     v2 = v1;
     
-    EXPECT_EQ(v2.length(), 3);
+    EXPECT_EQ(v2.length(), size_t(3));
     EXPECT_EQ(v2[0], 7);
 }
 
@@ -109,6 +109,28 @@ TEST(DynamicVector, DotProduct)
     EXPECT_EQ(res, 4);
 }
 
+TEST(DynamicVector, LongDotProductDoesNotDependOnThreadCount)
+{
+    const size_t n = 5 * PARALLEL_GRAIN + 7;
+    TDynamicVector<double> v1(n), v2(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        v1[i] = 1.0 / double(i + 1);
+        v2[i] = double(i % 13) - 6.5;
+    }
+    TSerialExecutor serialExecutor;
+    set_matrix_executor(&serialExecutor);
+    const double serial = v1 * v2;
+
+    TThreadPool pool(4);
+    set_matrix_executor(&pool);
+    const double parallel = v1 * v2;
+    set_matrix_executor(nullptr);
+
+    EXPECT_EQ(serial, parallel);
+    EXPECT_NEAR(tsimd::dot(n, v1.data(), v2.data()), parallel, 1e-9);
+}
+
 TEST(DynamicVector, OperationsThrowOnMismatch)
 {
     TDynamicVector<int> v1(2), v2(3);
@@ -116,3 +138,252 @@ TEST(DynamicVector, OperationsThrowOnMismatch)
     ASSERT_ANY_THROW(v1 - v2);
     ASSERT_ANY_THROW(v1 * v2);
 }
+
+TEST(DynamicVector, ChainedExpressionIsEvaluatedCorrectly)
+{
+    TDynamicVector<int> a(4), b(4), c(4);
+    for (int i = 0; i < 4; i++)
+    {
+        a[i] = i; b[i] = 10 * i; c[i] = i + 1;
+    }
+
+    TDynamicVector<int> res = a + b - c * 2;
+    for (int i = 0; i < 4; i++)
+        EXPECT_EQ(i + 10 * i - 2 * (i + 1), res[i]);
+}
+
+TEST(DynamicVector, ExpressionCanReadAssignedVector)
+{
+    TDynamicVector<int> a(3), b(3);
+    a[0] = 1; a[1] = 2; a[2] = 3;
+    b[0] = 1; b[1] = 1; b[2] = 1;
+
+    a = 2 * a + b;
+    EXPECT_EQ(3, a[0]);
+    EXPECT_EQ(5, a[1]);
+    EXPECT_EQ(7, a[2]);
+}
+
+TEST(DynamicVector, ChainedExpressionThrowsOnMismatch)
+{
+    TDynamicVector<int> v1(2), v2(2), v3(3);
+    ASSERT_ANY_THROW(v1 + v2 - v3);
+    ASSERT_ANY_THROW((v1 + v2) * v3);
+}
+
+TEST(DynamicVector, CompoundAssignment)
+{
+    TDynamicVector<int> v1(3), v2(3);
+    v1[0] = 1; v1[1] = 2; v1[2] = 3;
+    v2[0] = 1; v2[1] = 1; v2[2] = 1;
+
+    v1 += v2;
+    EXPECT_EQ(v1[2], 4);
+    v1 -= v2 * 2;
+    EXPECT_EQ(v1[2], 2);
+    v1 *= 3;
+    EXPECT_EQ(v1[2], 6);
+    v1.axpy(10, v2);
+    EXPECT_EQ(v1[2], 16);
+
+    ASSERT_ANY_THROW(v1 += TDynamicVector<int>(2));
+    ASSERT_ANY_THROW(v1.axpy(1, TDynamicVector<int>(4)));
+}
+
+TEST(DynamicVector, LargeOperationsRunInParallel)
+{
+    const size_t n = 200000;
+    TDynamicVector<double> x(n), y(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        x[i] = double(i % 100);
+        y[i] = 1.0;
+    }
+
+    set_matrix_threads(4);
+    TDynamicVector<double> z = x * 2.0 + y;
+    y.axpy(2.0, x);
+    set_matrix_threads(std::thread::hardware_concurrency());
+
+    EXPECT_EQ(z, y);
+    EXPECT_EQ(199.0, z[n - 1]);
+}
+
+TEST(DynamicVector, CanCreateUninitializedVector)
+{
+    TDynamicVector<int> v(5, uninitialized);
+    EXPECT_EQ(size_t(5), v.length());
+    ASSERT_ANY_THROW(TDynamicVector<int> w(0, uninitialized));
+    ASSERT_ANY_THROW(TDynamicVector<int> w(MAX_VECTOR_LEN + 1, uninitialized));
+}
+
+TEST(DynamicVector, AllocatesFromGivenResource)
+{
+    std::pmr::monotonic_buffer_resource arena;
+    TDynamicVector<int> v(5, &arena);
+    EXPECT_EQ(&arena, v.get_resource());
+
+    TDynamicVector<int> w(v + v, &arena);
+    EXPECT_EQ(&arena, w.get_resource());
+    EXPECT_EQ(TDynamicVector<int>(5), w);
+
+    TDynamicVector<int> c(v);
+    EXPECT_EQ(std::pmr::get_default_resource(), c.get_resource());
+}
+
+TEST(DynamicVector, MoveAcrossResourcesCopiesElements)
+{
+    std::pmr::monotonic_buffer_resource arena;
+    TDynamicVector<int> v(3);
+    TDynamicVector<int> a(3, &arena);
+    a[1] = 7;
+    const int* p = a.data();
+
+    v = std::move(a);
+    EXPECT_EQ(std::pmr::get_default_resource(), v.get_resource());
+    EXPECT_NE(p, v.data());
+    EXPECT_EQ(7, v[1]);
+
+    TDynamicVector<int> b(3, &arena);
+    p = b.data();
+    TDynamicVector<int> m(std::move(b));
+    EXPECT_EQ(&arena, m.get_resource());
+    EXPECT_EQ(p, m.data());
+}
+
+TEST(DynamicVector, DefaultResourceScopeRoutesTemporaries)
+{
+    std::pmr::unsynchronized_pool_resource pool;
+    {
+        TDefaultResourceScope scope(&pool);
+        TDynamicVector<double> v(10);
+        EXPECT_EQ(&pool, v.get_resource());
+    }
+    TDynamicVector<double> v(10);
+    EXPECT_EQ(std::pmr::get_default_resource(), v.get_resource());
+    EXPECT_NE(&pool, v.get_resource());
+}
+
+TEST(DynamicVector, CanUseHugePageResource)
+{
+    THugePageResource huge;
+    const size_t n = THugePageResource::HUGE_PAGE_SIZE / sizeof(double) + 1;
+    TDynamicVector<double> v(n, &huge);
+    v[n - 1] = 1.0;
+    EXPECT_EQ(0.0, v[0]);
+    EXPECT_EQ(1.0, v[n - 1]);
+
+    TDynamicVector<double> s(4, &huge);
+    EXPECT_EQ(0.0, s[3]);
+}
+
+TEST(DynamicVector, StorageIsCacheLineAligned)
+{
+    TDynamicVector<char> c(3);
+    TDynamicVector<double> d(7, uninitialized);
+    TDynamicVector<double> e(d + d);
+    EXPECT_EQ(uintptr_t(0), reinterpret_cast<uintptr_t>(c.data()) % 64);
+    EXPECT_EQ(uintptr_t(0), reinterpret_cast<uintptr_t>(d.data()) % 64);
+    EXPECT_EQ(uintptr_t(0), reinterpret_cast<uintptr_t>(e.data()) % 64);
+}
+
+TEST(DynamicVector, OperatorsReuseRvalueStorage)
+{
+    TDynamicVector<int> a(4), b(4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        a[i] = int(i);
+        b[i] = 10;
+    }
+
+    TDynamicVector<int> t(a);
+    const int* p = t.data();
+    TDynamicVector<int> r = std::move(t) + b - a;
+    EXPECT_EQ(p, r.data());
+    EXPECT_EQ(b, r);
+
+    TDynamicVector<int> u(a);
+    p = u.data();
+    TDynamicVector<int> s = b - std::move(u) * 2 + 1;
+    EXPECT_EQ(p, s.data());
+    EXPECT_EQ(7, s[2]);
+
+    ASSERT_ANY_THROW(TDynamicVector<int>(3) + a);
+}
+
+class TCountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST(DynamicVector, ChainedTemporariesAllocateOnce)
+{
+    TDynamicVector<double> a(1000), b(1000), c(1000);
+    for (size_t i = 0; i < 1000; i++) a[i] = b[i] = c[i] = 1.0;
+
+    TCountingResource counting;
+    {
+        TDefaultResourceScope scope(&counting);
+        TDynamicVector<double> r = TDynamicVector<double>(a) + b * 2.0 + c - a;
+        EXPECT_EQ(3.0, r[999]);
+    }
+    EXPECT_EQ(size_t(1), counting.allocations);
+}
+
+TEST(DynamicVector, BorrowedVectorWorksOnCallerArray)
+{
+    int arr[4] = { 1, 2, 3, 4 };
+    {
+        TDynamicVector<int> v(arr, 4, borrow);
+        EXPECT_EQ(arr, v.data());
+        v[1] = 20;
+        v *= 2;
+        TDynamicVector<int> w(v);
+        EXPECT_NE(arr, w.data());
+        EXPECT_EQ(40, w[1]);
+    }
+    EXPECT_EQ(2, arr[0]);
+    EXPECT_EQ(40, arr[1]);
+    ASSERT_ANY_THROW(TDynamicVector<int>(arr, 0, borrow));
+}
+
+TEST(DynamicVector, AdoptedVectorCallsDeleterOnce)
+{
+    int deleted = 0;
+    auto deleter = [&deleted](int* p) { ++deleted; delete[] p; };
+    {
+        int* arr = new int[3]();
+        TDynamicVector<int> v(arr, 3, adopt, deleter);
+        EXPECT_EQ(arr, v.data());
+        TDynamicVector<int> moved(std::move(v));
+        EXPECT_EQ(arr, moved.data());
+        EXPECT_EQ(0, deleted);
+    }
+    EXPECT_EQ(1, deleted);
+
+    TDynamicVector<int> v(new int[3](), 3, adopt, deleter);
+    v = TDynamicVector<int>(5);
+    EXPECT_EQ(2, deleted);
+    EXPECT_EQ(size_t(5), v.length());
+
+    ASSERT_ANY_THROW(TDynamicVector<int>(new int[1](), 0, adopt, deleter));
+    EXPECT_EQ(3, deleted);
+}
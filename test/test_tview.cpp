@@ -0,0 +1,170 @@
+#include "tmatrix.h"
+#include <gtest.h>
+
+static TDynamicMatrix<int> numbered(size_t rows, size_t cols)
+{
+    TDynamicMatrix<int> m(rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            m(i, j) = int(10 * i + j);
+    return m;
+}
+
+TEST(VectorView, SliceReferencesVectorElements)
+{
+    TDynamicVector<int> v(10);
+    for (size_t i = 0; i < 10; ++i) v[i] = int(i);
+
+    TVectorView<int> s = v.slice(1, 3, 4);
+    EXPECT_EQ(size_t(3), s.length());
+    EXPECT_EQ(size_t(4), s.stride());
+    EXPECT_EQ(5, s[1]);
+
+    s[2] = 100;
+    EXPECT_EQ(100, v[9]);
+}
+
+TEST(VectorView, ThrowsWhenSliceExceedsVector)
+{
+    TDynamicVector<int> v(10);
+    ASSERT_NO_THROW(v.slice(9, 1));
+    ASSERT_NO_THROW(v.slice(0, 4, 3));
+    ASSERT_ANY_THROW(v.slice(0, 5, 3));
+    ASSERT_ANY_THROW(v.slice(10, 1));
+    ASSERT_ANY_THROW(v.slice(0, 2, 0));
+}
+
+TEST(VectorView, CanAssignAndUpdateStridedElements)
+{
+    TDynamicVector<int> v(6), w(3);
+    w[0] = 1; w[1] = 2; w[2] = 3;
+
+    TVectorView<int> even = v.slice(0, 3, 2);
+    even = w + w;
+    even += w;
+    even *= 2;
+    EXPECT_EQ(6, v[0]);
+    EXPECT_EQ(0, v[1]);
+    EXPECT_EQ(12, v[2]);
+    EXPECT_EQ(18, v[4]);
+
+    TDynamicVector<int> copy(v.slice(1, 3, 2) + even);
+    EXPECT_EQ(12, copy[1]);
+    EXPECT_EQ(6 * 1 + 12 * 2 + 18 * 3, even * w);
+    ASSERT_ANY_THROW(even = v);
+}
+
+TEST(MatrixView, SubmatrixReferencesMatrixElements)
+{
+    TDynamicMatrix<int> m = numbered(5, 6);
+    TMatrixView<int> b = m.submatrix(1, 2, 3, 4);
+    EXPECT_EQ(size_t(3), b.rows());
+    EXPECT_EQ(size_t(4), b.cols());
+    EXPECT_EQ(m.get_stride(), b.get_stride());
+    EXPECT_EQ(m.row_data(1) + 2, b.data());
+    EXPECT_EQ(35, b(2, 3));
+
+    b(0, 0) = -1;
+    EXPECT_EQ(-1, m(1, 2));
+
+    TMatrixView<int> inner = b.submatrix(1, 1, 2, 2);
+    EXPECT_EQ(34, inner(1, 1));
+}
+
+TEST(MatrixView, ThrowsWhenSubmatrixExceedsMatrix)
+{
+    TDynamicMatrix<int> m(4, 5);
+    ASSERT_NO_THROW(m.submatrix(0, 0, 4, 5));
+    ASSERT_NO_THROW(m.submatrix(4, 5, 0, 0));
+    ASSERT_ANY_THROW(m.submatrix(1, 0, 4, 5));
+    ASSERT_ANY_THROW(m.submatrix(0, 3, 1, 3));
+    ASSERT_ANY_THROW(m.submatrix(5, 0, 0, 1));
+}
+
+TEST(MatrixView, ColumnAndDiagonalAreStrided)
+{
+    TDynamicMatrix<int> m = numbered(4, 3);
+    const TDynamicMatrix<int>& cm = m;
+
+    TVectorView<const int> c = cm.col(1);
+    EXPECT_EQ(size_t(4), c.length());
+    EXPECT_EQ(31, c[3]);
+
+    TVectorView<const int> d = cm.diagonal();
+    EXPECT_EQ(size_t(3), d.length());
+    EXPECT_EQ(22, d[2]);
+
+    m.col(0) = m.col(2);
+    EXPECT_EQ(32, m(3, 0));
+    m.diagonal() *= 0;
+    EXPECT_EQ(0, m(1, 1));
+    ASSERT_ANY_THROW(m.col(3));
+
+    EXPECT_EQ(21, m.row(2)[1]);
+}
+
+TEST(MatrixView, CanBeUsedInExpressions)
+{
+    TDynamicMatrix<int> m = numbered(4, 4);
+    TDynamicMatrix<int> sum = m.submatrix(0, 0, 2, 2) + m.submatrix(2, 2, 2, 2) * 2;
+    EXPECT_EQ(0 + 2 * 22, sum(0, 0));
+    EXPECT_EQ(11 + 2 * 33, sum(1, 1));
+
+    m.submatrix(0, 0, 2, 2) += m.submatrix(2, 2, 2, 2);
+    EXPECT_EQ(22, m(0, 0));
+    m.submatrix(2, 0, 2, 4) = TDynamicMatrix<int>(2, 4);
+    EXPECT_EQ(0, m(3, 3));
+    EXPECT_EQ(13, m(1, 3));
+    ASSERT_ANY_THROW(m.submatrix(0, 0, 2, 2) = m.submatrix(0, 0, 3, 2));
+}
+
+TEST(MatrixView, AssignmentFromOverlappingBlockDoesNotAlias)
+{
+    TDynamicMatrix<int> a = numbered(5, 5), b = numbered(5, 5), c = numbered(5, 5);
+    TDynamicMatrix<int> expected(a.submatrix(1, 1, 3, 3).t());
+    TMatrixView<int> va = a.submatrix(1, 1, 3, 3);
+    va = va.t();
+    EXPECT_EQ(expected, TDynamicMatrix<int>(va));
+
+    expected = TDynamicMatrix<int>(b.submatrix(0, 0, 3, 3)) * 2 + b.submatrix(1, 1, 3, 3);
+    TMatrixView<int> vb = b.submatrix(1, 1, 3, 3);
+    vb = b.submatrix(0, 0, 3, 3) * 2 + vb;
+    EXPECT_EQ(expected, TDynamicMatrix<int>(vb));
+
+    expected = TDynamicMatrix<int>(c.submatrix(1, 1, 3, 3)) + c.submatrix(0, 1, 3, 3);
+    TMatrixView<int> vc = c.submatrix(1, 1, 3, 3);
+    vc += c.submatrix(0, 1, 3, 3);
+    EXPECT_EQ(expected, TDynamicMatrix<int>(vc));
+}
+
+TEST(MatrixView, ProductsReadViewsInPlace)
+{
+    TDynamicMatrix<double> a(5, 7), b(7, 4);
+    for (size_t i = 0; i < 5; ++i)
+        for (size_t j = 0; j < 7; ++j)
+            a(i, j) = double(i + 2 * j) / 3;
+    for (size_t i = 0; i < 7; ++i)
+        for (size_t j = 0; j < 4; ++j)
+            b(i, j) = double(i) - double(j);
+
+    TDynamicMatrix<double> blockA(a.submatrix(1, 2, 3, 4));
+    TDynamicMatrix<double> blockB(b.submatrix(3, 1, 4, 3));
+    EXPECT_EQ(blockA * blockB, a.submatrix(1, 2, 3, 4) * b.submatrix(3, 1, 4, 3));
+    EXPECT_EQ(blockA * blockB, blockA * b.submatrix(3, 1, 4, 3));
+    EXPECT_EQ(blockA * blockB, a.submatrix(1, 2, 3, 4) * blockB);
+
+    TDynamicVector<double> x(4);
+    for (size_t i = 0; i < 4; ++i) x[i] = double(i) + 1;
+    EXPECT_EQ(blockA * x, a.submatrix(1, 2, 3, 4) * x);
+    EXPECT_EQ(blockA * TDynamicVector<double>(b.submatrix(3, 2, 4, 1).col(0)),
+              a.submatrix(1, 2, 3, 4) * b.submatrix(3, 2, 4, 1).col(0));
+}
+
+TEST(MatrixView, WritableViewDetachesSharedMatrix)
+{
+    TDynamicMatrix<int> a = numbered(3, 3);
+    TDynamicMatrix<int> b(a, copy_on_write);
+    b.submatrix(0, 0, 1, 1)(0, 0) = 5;
+    EXPECT_EQ(0, a(0, 0));
+    EXPECT_EQ(5, b(0, 0));
+}